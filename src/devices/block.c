@@ -119,6 +119,27 @@ void block_read(struct block* block, block_sector_t sector, void* buffer)
 	block->read_cnt++;
 }
 
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK,
+	sector SECTOR + I into BUFFERS[I], each of which must have room
+	for BLOCK_SECTOR_SIZE bytes.  Drivers that can do so transfer
+	the whole run with one command. */
+void block_read_multiple(
+	 struct block* block, block_sector_t sector, size_t cnt, void* const buffers[])
+{
+	size_t i;
+
+	if (cnt == 0)
+		return;
+	check_sector(block, sector);
+	check_sector(block, sector + cnt - 1);
+	if (block->ops->read_multiple != NULL)
+		block->ops->read_multiple(block->aux, sector, cnt, buffers);
+	else
+		for (i = 0; i < cnt; i++)
+			block->ops->read(block->aux, sector + i, buffers[i]);
+	block->read_cnt += cnt;
+}
+
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
 	BLOCK_SECTOR_SIZE bytes.  Returns after the block device has
 	acknowledged receiving the data.
@@ -132,6 +153,29 @@ void block_write(struct block* block, block_sector_t sector, const void* buffer)
 	block->write_cnt++;
 }
 
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK,
+	sector SECTOR + I from BUFFERS[I], each of which must contain
+	BLOCK_SECTOR_SIZE bytes.  Drivers that can do so transfer the
+	whole run with one command.  Returns after the block device
+	has acknowledged receiving the data. */
+void block_write_multiple(
+	 struct block* block, block_sector_t sector, size_t cnt, const void* const buffers[])
+{
+	size_t i;
+
+	if (cnt == 0)
+		return;
+	check_sector(block, sector);
+	check_sector(block, sector + cnt - 1);
+	ASSERT(block->type != BLOCK_FOREIGN);
+	if (block->ops->write_multiple != NULL)
+		block->ops->write_multiple(block->aux, sector, cnt, buffers);
+	else
+		for (i = 0; i < cnt; i++)
+			block->ops->write(block->aux, sector + i, buffers[i]);
+	block->write_cnt += cnt;
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t block_size(struct block* block)
 {
@@ -51,7 +51,9 @@ struct block* block_next(struct block*);
 /* Block device operations. */
 block_sector_t block_size(struct block*);
 void block_read(struct block*, block_sector_t, void*);
+void block_read_multiple(struct block*, block_sector_t, size_t cnt, void* const[]);
 void block_write(struct block*, block_sector_t, const void*);
+void block_write_multiple(struct block*, block_sector_t, size_t cnt, const void* const[]);
 const char* block_name(struct block*);
 enum block_type block_type(struct block*);
 
@@ -63,6 +65,11 @@ void block_print_stats(void);
 struct block_operations {
 	void (*read)(void* aux, block_sector_t, void* buffer);
 	void (*write)(void* aux, block_sector_t, const void* buffer);
+
+	/* Optional; block_write_multiple() and block_read_multiple()
+		fall back to WRITE and READ. */
+	void (*write_multiple)(void* aux, block_sector_t, size_t cnt, const void* const buffers[]);
+	void (*read_multiple)(void* aux, block_sector_t, size_t cnt, void* const buffers[]);
 };
 
 struct block* block_register(
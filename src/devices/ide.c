@@ -52,6 +52,10 @@
 #define CMD_READ_SECTOR_RETRY	 0x20 /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30 /* WRITE SECTOR with retries. */
 
+/* Most sectors one command can transfer.  A sector count of 0
+	in the register means this many. */
+#define ATA_MAX_SECTORS 256
+
 /* An ATA device. */
 struct ata_disk {
 	char name[8];				 /* Name, e.g. "hda". */
@@ -85,7 +89,7 @@ static void reset_channel(struct channel*);
 static bool check_device_type(struct ata_disk*);
 static void identify_ata_device(struct ata_disk*);
 
-static void select_sector(struct ata_disk*, block_sector_t);
+static void select_sector(struct ata_disk*, block_sector_t, size_t cnt);
 static void issue_pio_command(struct channel*, uint8_t command);
 static void input_sector(struct channel*, void*);
 static void output_sector(struct channel*, const void*);
@@ -120,7 +124,7 @@ void ide_init(void)
 			default:
 				NOT_REACHED();
 		}
-		lock_init(&c->lock);
+		lock_init_named(&c->lock, c->name);
 		c->expecting_interrupt = false;
 		sema_init(&c->completion_wait, 0);
 
@@ -324,7 +328,7 @@ static void ide_read(void* d_, block_sector_t sec_no, void* buffer)
 	struct ata_disk* d = d_;
 	struct channel* c = d->channel;
 	lock_acquire(&c->lock);
-	select_sector(d, sec_no);
+	select_sector(d, sec_no, 1);
 	issue_pio_command(c, CMD_READ_SECTOR_RETRY);
 	sema_down(&c->completion_wait);
 	if (!wait_while_busy(d))
@@ -343,7 +347,7 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer)
 	struct ata_disk* d = d_;
 	struct channel* c = d->channel;
 	lock_acquire(&c->lock);
-	select_sector(d, sec_no);
+	select_sector(d, sec_no, 1);
 	issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
 	if (!wait_while_busy(d))
 		PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
@@ -352,19 +356,83 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer)
 	lock_release(&c->lock);
 }
 
-static struct block_operations ide_operations = {ide_read, ide_write};
+/* Writes CNT sectors starting at SEC_NO to disk D, sector
+	SEC_NO + I from BUFFERS[I].  Each command moves up to
+	ATA_MAX_SECTORS sectors; the disk interrupts after taking each
+	one.  Returns after the disk has acknowledged receiving all of
+	the data.
+	Internally synchronizes accesses to disks, so external
+	per-disk locking is unneeded. */
+static void ide_write_multiple(
+	 void* d_, block_sector_t sec_no, size_t cnt, const void* const buffers[])
+{
+	struct ata_disk* d = d_;
+	struct channel* c = d->channel;
+	lock_acquire(&c->lock);
+	while (cnt > 0) {
+		size_t n = cnt < ATA_MAX_SECTORS ? cnt : ATA_MAX_SECTORS;
+		size_t i;
+
+		select_sector(d, sec_no, n);
+		issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
+		for (i = 0; i < n; i++) {
+			if (!wait_while_busy(d))
+				PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no + i);
+			output_sector(c, buffers[i]);
+			sema_down(&c->completion_wait);
+		}
+		sec_no += n;
+		buffers += n;
+		cnt -= n;
+	}
+	lock_release(&c->lock);
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D, sector
+	SEC_NO + I into BUFFERS[I].  Each command moves up to
+	ATA_MAX_SECTORS sectors; the disk interrupts as each one is
+	ready.
+	Internally synchronizes accesses to disks, so external
+	per-disk locking is unneeded. */
+static void ide_read_multiple(void* d_, block_sector_t sec_no, size_t cnt, void* const buffers[])
+{
+	struct ata_disk* d = d_;
+	struct channel* c = d->channel;
+	lock_acquire(&c->lock);
+	while (cnt > 0) {
+		size_t n = cnt < ATA_MAX_SECTORS ? cnt : ATA_MAX_SECTORS;
+		size_t i;
+
+		select_sector(d, sec_no, n);
+		issue_pio_command(c, CMD_READ_SECTOR_RETRY);
+		for (i = 0; i < n; i++) {
+			sema_down(&c->completion_wait);
+			if (!wait_while_busy(d))
+				PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no + i);
+			input_sector(c, buffers[i]);
+		}
+		sec_no += n;
+		buffers += n;
+		cnt -= n;
+	}
+	lock_release(&c->lock);
+}
+
+static struct block_operations ide_operations
+	 = {ide_read, ide_write, ide_write_multiple, ide_read_multiple};
 
 /* Selects device D, waiting for it to become ready, and then
-	writes SEC_NO to the disk's sector selection registers.  (We
-	use LBA mode.) */
-static void select_sector(struct ata_disk* d, block_sector_t sec_no)
+	writes SEC_NO and the count CNT of sectors to transfer to the
+	disk's sector selection registers.  (We use LBA mode.) */
+static void select_sector(struct ata_disk* d, block_sector_t sec_no, size_t cnt)
 {
 	struct channel* c = d->channel;
 
-	ASSERT(sec_no < (1UL << 28));
+	ASSERT(sec_no + cnt <= (1UL << 28));
+	ASSERT(cnt >= 1 && cnt <= ATA_MAX_SECTORS);
 
 	select_device_wait(d);
-	outb(reg_nsect(c), 1);
+	outb(reg_nsect(c), cnt == ATA_MAX_SECTORS ? 0 : cnt);
 	outb(reg_lbal(c), sec_no);
 	outb(reg_lbam(c), sec_no >> 8);
 	outb(reg_lbah(c), (sec_no >> 16));
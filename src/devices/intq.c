@@ -3,16 +3,29 @@
 #include "threads/thread.h"
 
 #include <debug.h>
+#include <string.h>
 
-static int next(int pos);
+static int next(const struct intq* q, int pos);
 static void wait(struct intq* q, struct thread** waiter);
 static void signal(struct intq* q, struct thread** waiter);
 
-/* Initializes interrupt queue Q. */
+/* Initializes interrupt queue Q with its built-in buffer. */
 void intq_init(struct intq* q)
 {
+	intq_init_buf(q, q->storage, sizeof q->storage);
+}
+
+/* Initializes interrupt queue Q to use the SIZE bytes at BUF,
+	which must outlive it, as its buffer.  Q holds at most SIZE - 1
+	bytes at once. */
+void intq_init_buf(struct intq* q, uint8_t* buf, size_t size)
+{
+	ASSERT(size >= 2);
+
 	lock_init(&q->lock);
 	q->not_full = q->not_empty = NULL;
+	q->buf = buf;
+	q->size = size;
 	q->head = q->tail = 0;
 }
 
@@ -27,7 +40,7 @@ bool intq_empty(const struct intq* q)
 bool intq_full(const struct intq* q)
 {
 	ASSERT(intr_get_level() == INTR_OFF);
-	return next(q->head) == q->tail;
+	return next(q, q->head) == q->tail;
 }
 
 /* Removes a byte from Q and returns it.
@@ -46,7 +59,7 @@ uint8_t intq_getc(struct intq* q)
 	}
 
 	byte = q->buf[q->tail];
-	q->tail = next(q->tail);
+	q->tail = next(q, q->tail);
 	signal(q, &q->not_full);
 	return byte;
 }
@@ -65,14 +78,40 @@ void intq_putc(struct intq* q, uint8_t byte)
 	}
 
 	q->buf[q->head] = byte;
-	q->head = next(q->head);
+	q->head = next(q, q->head);
 	signal(q, &q->not_empty);
 }
 
-/* Returns the position after POS within an intq. */
-static int next(int pos)
+/* Adds as many of the N bytes at BUF to the end of Q as fit
+	without sleeping, and returns the number added.  Unlike
+	repeated intq_putc() calls, copies in at most two runs and
+	wakes a waiting reader only once. */
+size_t intq_putbuf(struct intq* q, const uint8_t* buf, size_t n)
+{
+	size_t done = 0;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	while (done < n && !intq_full(q)) {
+		/* Copy up to the end of the buffer or the byte before
+			TAIL, whichever comes first. */
+		int end = q->tail > q->head ? q->tail - 1 : q->size - (q->tail == 0);
+		size_t run = end - q->head;
+
+		if (run > n - done)
+			run = n - done;
+		memcpy(q->buf + q->head, buf + done, run);
+		q->head = (q->head + run) % q->size;
+		done += run;
+	}
+	if (done > 0)
+		signal(q, &q->not_empty);
+	return done;
+}
+
+/* Returns the position after POS within Q. */
+static int next(const struct intq* q, int pos)
 {
-	return (pos + 1) % INTQ_BUFSIZE;
+	return (pos + 1) % q->size;
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
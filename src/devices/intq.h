@@ -4,6 +4,8 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 
+#include <stddef.h>
+
 /* An "interrupt queue", a circular buffer shared between
 	kernel threads and external interrupt handlers.
 
@@ -17,7 +19,7 @@
 	protect kernel threads from one another, not from interrupt
 	handlers. */
 
-/* Queue buffer size, in bytes. */
+/* Size of the buffer built into each queue, in bytes. */
 #define INTQ_BUFSIZE 64
 
 /* A circular queue of bytes. */
@@ -28,15 +30,19 @@ struct intq {
 	struct thread* not_empty; /* Thread waiting for not-empty condition. */
 
 	/* Queue. */
-	uint8_t buf[INTQ_BUFSIZE]; /* Buffer. */
-	int head;						/* New data is written here. */
-	int tail;						/* Old data is read here. */
+	uint8_t* buf;						 /* Buffer, either STORAGE or the caller's. */
+	int size;							 /* Size of BUF. */
+	int head;							 /* New data is written here. */
+	int tail;							 /* Old data is read here. */
+	uint8_t storage[INTQ_BUFSIZE]; /* Default buffer. */
 };
 
 void intq_init(struct intq*);
+void intq_init_buf(struct intq*, uint8_t* buf, size_t size);
 bool intq_empty(const struct intq*);
 bool intq_full(const struct intq*);
 uint8_t intq_getc(struct intq*);
 void intq_putc(struct intq*, uint8_t);
+size_t intq_putbuf(struct intq*, const uint8_t*, size_t);
 
 #endif /* devices/intq.h */
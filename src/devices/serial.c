@@ -35,6 +35,17 @@
 #define MCR_REG (IO_BASE + 4) /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5) /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01	  /* Enable the receive and transmit FIFOs. */
+#define FCR_CLEAR_RX 0x02 /* Empty the receive FIFO. */
+#define FCR_CLEAR_TX 0x04 /* Empty the transmit FIFO. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0 /* Both set if the FIFOs are enabled. */
+
+/* Depth of the 16550A transmit FIFO. */
+#define FIFO_SIZE 16
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01 /* Interrupt when data received. */
 #define IER_XMIT 0x02 /* Interrupt when transmit finishes. */
@@ -53,8 +64,16 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
+/* Data to be transmitted.  The queue is much larger than the
+	built-in intq buffer, so that a burst of console output can be
+	queued at once rather than waiting on the port byte by byte. */
+#define TXQ_SIZE 4096
 static struct intq txq;
+static uint8_t txq_buf[TXQ_SIZE];
+
+/* Bytes the UART accepts at once when its transmitter is empty:
+	FIFO_SIZE if it has a working FIFO, otherwise 1. */
+static int tx_burst = 1;
 
 static void set_serial(int bps);
 static void putc_poll(uint8_t);
@@ -72,7 +91,7 @@ static void init_poll(void)
 	outb(FCR_REG, 0);			 /* Disable FIFO. */
 	set_serial(9600);			 /* 9.6 kbps, N-8-1. */
 	outb(MCR_REG, MCR_OUT2); /* Required to enable interrupts. */
-	intq_init(&txq);
+	intq_init_buf(&txq, txq_buf, sizeof txq_buf);
 	mode = POLL;
 }
 
@@ -87,6 +106,16 @@ void serial_init_queue(void)
 		init_poll();
 	ASSERT(mode == POLL);
 
+	/* Turn on the FIFOs, if the UART has them, so that each
+		transmit interrupt can hand over a burst of bytes.  The
+		receive trigger level stays at 1 byte, so input is seen at
+		once. */
+	outb(FCR_REG, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX);
+	if ((inb(IIR_REG) & IIR_FIFO) == IIR_FIFO)
+		tx_burst = FIFO_SIZE;
+	else
+		outb(FCR_REG, 0);
+
 	intr_register_ext(0x20 + 4, serial_interrupt, "serial");
 	mode = QUEUE;
 	old_level = intr_disable();
@@ -125,6 +154,43 @@ void serial_putc(uint8_t byte)
 	intr_set_level(old_level);
 }
 
+/* Sends the N bytes in BUF to the serial port.  In queued mode
+	this takes interrupts off once per run of bytes that fits in
+	the transmit queue, rather than once per byte. */
+void serial_write_buf(const uint8_t* buf, size_t n)
+{
+	enum intr_level old_level = intr_disable();
+
+	if (mode != QUEUE) {
+		if (mode == UNINIT)
+			init_poll();
+		while (n-- > 0)
+			putc_poll(*buf++);
+	}
+	else {
+		while (n > 0) {
+			size_t added = intq_putbuf(&txq, buf, n);
+			buf += added;
+			n -= added;
+			write_ier();
+			if (n == 0)
+				break;
+
+			/* The queue is full.  As in serial_putc(), make room by
+				polling if interrupts were off, otherwise sleep until
+				the interrupt handler drains a byte. */
+			if (old_level == INTR_OFF)
+				putc_poll(intq_getc(&txq));
+			else {
+				intq_putc(&txq, *buf++);
+				n--;
+			}
+		}
+	}
+
+	intr_set_level(old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
 	mode. */
 void serial_flush(void)
@@ -205,10 +271,14 @@ static void serial_interrupt(struct intr_frame* f UNUSED)
 		has a byte for us, receive a byte.  */
 	while (!input_full() && (inb(LSR_REG) & LSR_DR) != 0) input_putc(inb(RBR_REG));
 
-	/* As long as we have a byte to transmit, and the hardware is
-		ready to accept a byte for transmission, transmit a byte. */
-	while (!intq_empty(&txq) && (inb(LSR_REG) & LSR_THRE) != 0)
-		outb(THR_REG, intq_getc(&txq));
+	/* As long as we have bytes to transmit, and the hardware is
+		ready to accept them, transmit a burst.  THR Empty means the
+		whole transmit FIFO is free. */
+	while (!intq_empty(&txq) && (inb(LSR_REG) & LSR_THRE) != 0) {
+		int i;
+		for (i = 0; i < tx_burst && !intq_empty(&txq); i++)
+			outb(THR_REG, intq_getc(&txq));
+	}
 
 	/* Update interrupt enable register based on queue status. */
 	write_ier();
@@ -4,17 +4,25 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 #include <console.h>
 #include <stdio.h>
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -129,7 +137,15 @@ static void print_stats(void)
 #endif
 	console_print_stats();
 	kbd_print_stats();
+	lockstat_print_stats();
+	workqueue_print_stats();
 #ifdef USERPROG
 	exception_print_stats();
+	pagedir_print_stats();
+	syscall_print_stats();
+#endif
+#ifdef VM
+	page_print_stats();
+	swap_print_stats();
 #endif
 }
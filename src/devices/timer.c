@@ -4,6 +4,7 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #include "lib/kernel/list.h"
 
 #include <debug.h>
@@ -189,6 +190,7 @@ static void timer_interrupt(struct intr_frame* args UNUSED)
 {
 	ticks++;
 	thread_tick();
+	workqueue_tick(ticks);
 
 	// Loop over the sleeping list
 	// If any elements in the start have passed their sleeping time,
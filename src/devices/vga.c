@@ -30,6 +30,7 @@ static uint8_t (*fb)[COL_CNT][2];
 
 static void clear_row(size_t y);
 static void cls(void);
+static void putc_raw(int c, enum intr_level old_level);
 static void newline(void);
 static void move_cursor(void);
 static void find_cursor(size_t* x, size_t* y);
@@ -55,7 +56,33 @@ void vga_putc(int c)
 	enum intr_level old_level = intr_disable();
 
 	init();
+	putc_raw(c, old_level);
 
+	/* Update cursor position. */
+	move_cursor();
+
+	intr_set_level(old_level);
+}
+
+/* Writes the N characters in BUF to the VGA text display, as if
+	by vga_putc() on each, but with interrupts turned off once and
+	the hardware cursor moved only at the end. */
+void vga_write_buf(const char* buf, size_t n)
+{
+	enum intr_level old_level = intr_disable();
+
+	init();
+	while (n-- > 0)
+		putc_raw((uint8_t) *buf++, old_level);
+	move_cursor();
+
+	intr_set_level(old_level);
+}
+
+/* Writes C to the display without moving the hardware cursor.
+	Interrupts must be off; OLD_LEVEL is the level to beep at. */
+static void putc_raw(int c, enum intr_level old_level)
+{
 	switch (c) {
 		case '\n':
 			newline();
@@ -93,11 +120,6 @@ void vga_putc(int c)
 				newline();
 			break;
 	}
-
-	/* Update cursor position. */
-	move_cursor();
-
-	intr_set_level(old_level);
 }
 
 /* Clears the screen and moves the cursor to the upper left. */
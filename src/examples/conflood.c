@@ -0,0 +1,57 @@
+/* conflood.c
+
+	Floods the console with text, first one byte per write() and
+	then a page per write(), and reports the rate of each in
+	characters per million cycles.  Compare the two lines, or the
+	results from different kernels, to see what the console
+	output path costs.
+
+	Usage: conflood [KILOBYTES] */
+
+#include <cpu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define CHUNK 4096
+#define LINE 64
+
+static char text[CHUNK];
+
+/* Writes SIZE bytes of TEXT to the console in CHUNK-byte writes
+	and returns the cycles taken. */
+static uint64_t flood(int size, int chunk)
+{
+	uint64_t start = rdtsc();
+	int done;
+
+	for (done = 0; done < size; done += chunk)
+		write(STDOUT_FILENO, text + done % CHUNK, chunk);
+	return rdtsc() - start;
+}
+
+int main(int argc, char* argv[])
+{
+	int kb = argc > 1 ? atoi(argv[1]) : 16;
+	uint64_t bytewise, bulk;
+	int i;
+
+	if (kb <= 0) {
+		printf("usage: conflood [KILOBYTES]\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Lines of printable characters, so the display scrolls. */
+	for (i = 0; i < CHUNK; i++)
+		text[i] = i % LINE == LINE - 1 ? '\n' : 'a' + i % 26;
+
+	bytewise = flood(kb * 1024, 1);
+	bulk = flood(kb * 1024, CHUNK);
+
+	printf("conflood: %d KB, 1-byte writes: %llu chars/Mcycle\n",
+			 kb, kb * 1024 * 1000000ULL / (bytewise > 0 ? bytewise : 1));
+	printf("conflood: %d KB, %d-byte writes: %llu chars/Mcycle\n",
+			 kb, CHUNK, kb * 1024 * 1000000ULL / (bulk > 0 ? bulk : 1));
+	return EXIT_SUCCESS;
+}
@@ -1,13 +1,28 @@
-/* cat.c
+/* cp.c
 
 Copies one file to another. */
 
 #include <stdio.h>
 #include <syscall.h>
 
+/* Copies the rest of IN_FD to OUT_FD with read() and write(),
+	for kernels without copy_file_range().  Returns true if
+	successful. */
+static bool copy_by_hand(int in_fd, int out_fd)
+{
+	for (;;) {
+		char buffer[1024];
+		int bytes_read = read(in_fd, buffer, sizeof buffer);
+		if (bytes_read == 0)
+			return true;
+		if (write(out_fd, buffer, bytes_read) != bytes_read)
+			return false;
+	}
+}
+
 int main(int argc, char* argv[])
 {
-	int in_fd, out_fd;
+	int in_fd, out_fd, size, copied;
 
 	if (argc != 3) {
 		printf("usage: cp OLD NEW\n");
@@ -22,7 +37,8 @@ int main(int argc, char* argv[])
 	}
 
 	/* Create and open output file. */
-	if (!create(argv[2], filesize(in_fd))) {
+	size = filesize(in_fd);
+	if (!create(argv[2], size)) {
 		printf("%s: create failed\n", argv[2]);
 		return EXIT_FAILURE;
 	}
@@ -32,17 +48,19 @@ int main(int argc, char* argv[])
 		return EXIT_FAILURE;
 	}
 
-	/* Copy data. */
-	for (;;) {
-		char buffer[1024];
-		int bytes_read = read(in_fd, buffer, sizeof buffer);
-		if (bytes_read == 0)
-			break;
-		if (write(out_fd, buffer, bytes_read) != bytes_read) {
+	/* Copy data inside the kernel, falling back to copying it
+		through our own buffer if that is not supported. */
+	copied = copy_file_range(in_fd, out_fd, size);
+	if (copied < 0) {
+		if (!copy_by_hand(in_fd, out_fd)) {
 			printf("%s: write failed\n", argv[2]);
 			return EXIT_FAILURE;
 		}
 	}
+	else if (copied != size) {
+		printf("%s: write failed\n", argv[2]);
+		return EXIT_FAILURE;
+	}
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,142 @@
+/* iobench.c
+
+	Compares system call counts and cycles for record I/O done with
+	write() and seek() plus read() against the same work done with
+	writev() and pread().
+
+	Usage: iobench [RECORDS] */
+
+#include <cpu.h>
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define FILE_NAME "iobench.dat"
+#define HEADER_SIZE 16
+#define BODY_SIZE 96
+#define TRAILER_SIZE 16
+#define RECORD_SIZE (HEADER_SIZE + BODY_SIZE + TRAILER_SIZE)
+
+static char header[HEADER_SIZE], body[BODY_SIZE], trailer[TRAILER_SIZE];
+static char record[RECORD_SIZE];
+
+/* Prints one result line. */
+static void report(const char* name, int calls, uint64_t cycles)
+{
+	printf("%-18s %6d syscalls %12llu cycles\n", name, calls, cycles);
+}
+
+/* Opens FILE_NAME, exiting on failure. */
+static int open_file(void)
+{
+	int fd = open(FILE_NAME);
+	if (fd < 0) {
+		printf("iobench: open failed\n");
+		exit(EXIT_FAILURE);
+	}
+	return fd;
+}
+
+/* Writes RECORDS records as three write() calls each. */
+static void write_plain(int records)
+{
+	int fd = open_file();
+	int calls = 0;
+	uint64_t start = rdtsc();
+	int i;
+
+	for (i = 0; i < records; i++) {
+		write(fd, header, sizeof header);
+		write(fd, body, sizeof body);
+		write(fd, trailer, sizeof trailer);
+		calls += 3;
+	}
+	report("write x3", calls, rdtsc() - start);
+	close(fd);
+}
+
+/* Writes RECORDS records as one writev() call each. */
+static void write_vectored(int records)
+{
+	struct iovec iov[3] = {
+		{header, sizeof header},
+		{body, sizeof body},
+		{trailer, sizeof trailer},
+	};
+	int fd = open_file();
+	int calls = 0;
+	uint64_t start = rdtsc();
+	int i;
+
+	for (i = 0; i < records; i++) {
+		writev(fd, iov, 3);
+		calls++;
+	}
+	report("writev", calls, rdtsc() - start);
+	close(fd);
+}
+
+/* Reads RECORDS randomly chosen records with seek() and read(). */
+static void read_seek(int records)
+{
+	int fd = open_file();
+	int calls = 0;
+	uint64_t start = rdtsc();
+	int i;
+
+	random_init(0);
+	for (i = 0; i < records; i++) {
+		seek(fd, random_ulong() % records * RECORD_SIZE);
+		read(fd, record, sizeof record);
+		calls += 2;
+	}
+	report("seek + read", calls, rdtsc() - start);
+	close(fd);
+}
+
+/* Reads RECORDS randomly chosen records with pread(). */
+static void read_positional(int records)
+{
+	int fd = open_file();
+	int calls = 0;
+	uint64_t start = rdtsc();
+	int i;
+
+	random_init(0);
+	for (i = 0; i < records; i++) {
+		pread(fd, record, sizeof record, random_ulong() % records * RECORD_SIZE);
+		calls++;
+	}
+	report("pread", calls, rdtsc() - start);
+	close(fd);
+}
+
+int main(int argc, char* argv[])
+{
+	int records = argc > 1 ? atoi(argv[1]) : 200;
+
+	if (records <= 0) {
+		printf("usage: iobench [RECORDS]\n");
+		return EXIT_FAILURE;
+	}
+
+	memset(header, 'h', sizeof header);
+	memset(body, 'b', sizeof body);
+	memset(trailer, 't', sizeof trailer);
+
+	remove(FILE_NAME);
+	if (!create(FILE_NAME, records * RECORD_SIZE)) {
+		printf("iobench: create failed\n");
+		return EXIT_FAILURE;
+	}
+
+	write_plain(records);
+	write_vectored(records);
+	read_seek(records);
+	read_positional(records);
+
+	remove(FILE_NAME);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/* mallocbench.c
+
+	Measures malloc() and free() throughput for a few allocation
+	patterns: churn among small blocks, churn among large blocks,
+	and a growing realloc() buffer.  Reports cycles per operation
+	and how far the heap grew, so that the allocator's speed and
+	footprint can be tracked over time.
+
+	Usage: mallocbench [ROUNDS] */
+
+#include <cpu.h>
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define SLOTS 256
+
+static void* slots[SLOTS];
+
+/* Prints one result line. */
+static void report(const char* name, int ops, uint64_t cycles)
+{
+	printf("%-14s %8d ops %12llu cycles %6llu cycles/op\n",
+			 name, ops, cycles, cycles / (ops > 0 ? ops : 1));
+}
+
+/* Frees every block in SLOTS. */
+static void free_all(void)
+{
+	int i;
+
+	for (i = 0; i < SLOTS; i++) {
+		free(slots[i]);
+		slots[i] = NULL;
+	}
+}
+
+/* Runs ROUNDS steps that each free a random slot and refill it
+	with a block of MIN to MAX bytes.  Returns the number of
+	operations. */
+static int churn(int rounds, size_t min, size_t max)
+{
+	int ops = 0;
+	int i;
+
+	for (i = 0; i < rounds; i++) {
+		int slot = random_ulong() % SLOTS;
+		size_t size = min + random_ulong() % (max - min + 1);
+
+		free(slots[slot]);
+		slots[slot] = malloc(size);
+		if (slots[slot] == NULL) {
+			printf("mallocbench: out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+		memset(slots[slot], 0xa5, size < 16 ? size : 16);
+		ops += 2;
+	}
+	return ops;
+}
+
+/* Grows a buffer one byte at a time to SIZE bytes with
+	realloc().  Returns the number of operations. */
+static int grow(size_t size)
+{
+	char* buf = NULL;
+	size_t i;
+
+	for (i = 1; i <= size; i++) {
+		buf = realloc(buf, i);
+		if (buf == NULL) {
+			printf("mallocbench: out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+		buf[i - 1] = i;
+	}
+	free(buf);
+	return size + 1;
+}
+
+int main(int argc, char* argv[])
+{
+	int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+	char* heap_start = sbrk(0);
+	uint64_t start;
+	int ops;
+
+	if (rounds <= 0) {
+		printf("usage: mallocbench [ROUNDS]\n");
+		return EXIT_FAILURE;
+	}
+	random_init(0);
+
+	start = rdtsc();
+	ops = churn(rounds, 8, 256);
+	report("small churn", ops, rdtsc() - start);
+	free_all();
+
+	start = rdtsc();
+	ops = churn(rounds / 4, 1024, 4096);
+	report("large churn", ops, rdtsc() - start);
+	free_all();
+
+	start = rdtsc();
+	ops = grow(rounds);
+	report("realloc grow", ops, rdtsc() - start);
+
+	printf("heap now %d bytes\n", (int) ((char*) sbrk(0) - heap_start));
+	return EXIT_SUCCESS;
+}
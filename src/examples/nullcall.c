@@ -0,0 +1,73 @@
+/* nullcall.c
+
+	Measures the round-trip cost of a system call that does no
+	work, once through `int $0x30' and once through SYSENTER.
+
+	Usage: nullcall [ITERATIONS] */
+
+#include <cpu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+
+/* getpid() through the interrupt gate. */
+static int
+getpid_int(void)
+{
+	int retval;
+	asm volatile("pushl %[number]; int $0x30; addl $4, %%esp"
+					 : "=a"(retval)
+					 : [number] "i"(SYS_GETPID)
+					 : "memory");
+	return retval;
+}
+
+/* getpid() through SYSENTER. */
+static int
+getpid_sysenter(void)
+{
+	int retval;
+	asm volatile("pushl %[number]; movl %%esp, %%ecx; movl $1f, %%edx; "
+					 "sysenter; 1: addl $4, %%esp"
+					 : "=a"(retval)
+					 : [number] "i"(SYS_GETPID)
+					 : "ecx", "edx", "cc", "memory");
+	return retval;
+}
+
+/* Calls FUNC ITERATIONS times and prints the average number of
+	cycles per call under NAME. */
+static void
+measure(const char* name, int (*func)(void), int iterations)
+{
+	uint64_t start, cycles;
+	int i;
+
+	func();
+	start = rdtsc();
+	for (i = 0; i < iterations; i++)
+		func();
+	cycles = rdtsc() - start;
+
+	printf("%-10s %8d calls %10llu cycles/call\n", name, iterations,
+			 cycles / iterations);
+}
+
+int
+main(int argc, char* argv[])
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+	if (iterations <= 0) {
+		printf("usage: nullcall [ITERATIONS]\n");
+		return EXIT_FAILURE;
+	}
+
+	measure("int $0x30", getpid_int, iterations);
+	if (cpu_has_sysenter())
+		measure("sysenter", getpid_sysenter, iterations);
+	else
+		printf("sysenter   not supported by this CPU\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+/* ringbench.c
+
+	Reads a file in 512-byte blocks, once with one pread() per
+	block and once through an I/O ring that submits a whole batch
+	of reads with a single ioring_enter(), and reports the number
+	of system calls and cycles each took.
+
+	Usage: ringbench [BLOCKS] */
+
+#include <cpu.h>
+#include <ioring.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define FILE_NAME "ringbench.dat"
+#define BLOCK_SIZE 512
+#define MAX_BLOCKS 256
+#define RING_ENTRIES 64
+
+/* Where to map the ring.  Nothing else in this program lives
+	this high. */
+#define RING_ADDR ((void*) 0x20000000)
+
+static char blocks[MAX_BLOCKS][BLOCK_SIZE];
+
+/* Prints one result line. */
+static void report(const char* name, int calls, uint64_t cycles)
+{
+	printf("%-8s %6d syscalls %12llu cycles\n", name, calls, cycles);
+}
+
+/* Reads BLOCKS blocks from FD with pread(). */
+static void read_sync(int fd, int blocks_cnt)
+{
+	uint64_t start = rdtsc();
+	int i;
+
+	for (i = 0; i < blocks_cnt; i++)
+		pread(fd, blocks[i], BLOCK_SIZE, i * BLOCK_SIZE);
+	report("pread", blocks_cnt, rdtsc() - start);
+}
+
+/* Reads BLOCKS blocks from FD through ring H. */
+static void read_ring(struct ioring_hdr* h, int fd, int blocks_cnt)
+{
+	uint64_t start = rdtsc();
+	int calls = 0, queued = 0, done = 0;
+
+	while (done < blocks_cnt) {
+		struct ioring_sqe* sqe;
+		struct ioring_cqe* cqe;
+		int batch = 0;
+
+		/* Queue as many reads as fit. */
+		while (queued < blocks_cnt && (sqe = ioring_get_sqe(h)) != NULL) {
+			memset(sqe, 0, sizeof *sqe);
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = fd;
+			sqe->addr = blocks[queued];
+			sqe->len = BLOCK_SIZE;
+			sqe->offset = queued * BLOCK_SIZE;
+			sqe->user_data = queued;
+			ioring_commit_sqe(h);
+			queued++;
+			batch++;
+		}
+
+		/* Submit them and wait for at least one completion. */
+		ioring_enter(batch, 1);
+		calls++;
+
+		while ((cqe = ioring_peek_cqe(h)) != NULL) {
+			if (cqe->res != BLOCK_SIZE)
+				printf("ringbench: block %u: result %d\n", cqe->user_data, cqe->res);
+			ioring_cqe_seen(h);
+			done++;
+		}
+	}
+	report("ioring", calls, rdtsc() - start);
+}
+
+int main(int argc, char* argv[])
+{
+	int blocks_cnt = argc > 1 ? atoi(argv[1]) : 128;
+	struct ioring_hdr* h = RING_ADDR;
+	int fd;
+
+	if (blocks_cnt <= 0 || blocks_cnt > MAX_BLOCKS) {
+		printf("usage: ringbench [BLOCKS], BLOCKS at most %d\n", MAX_BLOCKS);
+		return EXIT_FAILURE;
+	}
+
+	remove(FILE_NAME);
+	if (!create(FILE_NAME, blocks_cnt * BLOCK_SIZE) || (fd = open(FILE_NAME)) < 0) {
+		printf("ringbench: cannot create %s\n", FILE_NAME);
+		return EXIT_FAILURE;
+	}
+	if (ioring_setup(RING_ENTRIES, RING_ADDR) < 0) {
+		printf("ringbench: ioring_setup failed\n");
+		return EXIT_FAILURE;
+	}
+
+	read_sync(fd, blocks_cnt);
+	read_ring(h, fd, blocks_cnt);
+
+	close(fd);
+	remove(FILE_NAME);
+	return EXIT_SUCCESS;
+}
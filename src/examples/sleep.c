@@ -2,4 +2,5 @@
 
 int main(void) {
     sleep(1000);
+    return EXIT_SUCCESS;
 }
\ No newline at end of file
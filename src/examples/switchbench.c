@@ -0,0 +1,76 @@
+/* switchbench.c
+
+	Measures the cost of switching between processes by bouncing
+	a byte back and forth between this process and a child over
+	two pipes.  Each round trip blocks each side once, so it costs
+	two process switches, each of which reloads CR3.
+
+	Usage: switchbench [ROUNDS] */
+
+#include <cpu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Child side: closes the ends of the pipes it does not use,
+	then echoes every byte read from RFD back to WFD until end of
+	file.  Exits with the number of bytes echoed. */
+static int echo(int rfd, int wfd, int unused_r, int unused_w)
+{
+	int rounds = 0;
+	char c;
+
+	close(unused_r);
+	close(unused_w);
+	while (read(rfd, &c, 1) == 1 && write(wfd, &c, 1) == 1)
+		rounds++;
+	return rounds;
+}
+
+int main(int argc, char* argv[])
+{
+	char cmd[64];
+	int ping[2], pong[2];
+	uint64_t start, cycles;
+	pid_t child;
+	int rounds, done, got;
+	char c = 'x';
+
+	if (argc == 6 && !strcmp(argv[1], "echo"))
+		return echo(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+
+	rounds = argc > 1 ? atoi(argv[1]) : 10000;
+	if (rounds <= 0) {
+		printf("usage: switchbench [ROUNDS]\n");
+		return EXIT_FAILURE;
+	}
+
+	if (pipe(ping) < 0 || pipe(pong) < 0) {
+		printf("switchbench: pipe failed\n");
+		return EXIT_FAILURE;
+	}
+	snprintf(cmd, sizeof cmd, "switchbench echo %d %d %d %d",
+				ping[0], pong[1], ping[1], pong[0]);
+	child = exec(cmd);
+	if (child < 0) {
+		printf("switchbench: exec failed\n");
+		return EXIT_FAILURE;
+	}
+	close(ping[0]);
+	close(pong[1]);
+
+	start = rdtsc();
+	for (done = 0; done < rounds; done++)
+		if (write(ping[1], &c, 1) != 1 || read(pong[0], &c, 1) != 1)
+			break;
+	cycles = rdtsc() - start;
+
+	close(ping[1]);
+	got = wait(child);
+
+	printf("%d round trips %12llu cycles %8llu cycles/switch%s\n",
+			 done, cycles, done > 0 ? cycles / (2 * done) : 0,
+			 got == done ? "" : " (short)");
+	return got == done ? EXIT_SUCCESS : EXIT_FAILURE;
+}
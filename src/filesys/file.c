@@ -2,6 +2,8 @@
 
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 
 #include <debug.h>
 
@@ -9,6 +11,7 @@
 struct file {
 	struct inode* inode; /* File's inode. */
 	off_t pos;				/* Current position. */
+	bool deny_write;		/* Has file_deny_write() been called? */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -20,6 +23,7 @@ struct file* file_open(struct inode* inode)
 	if (inode != NULL && file != NULL) {
 		file->inode = inode;
 		file->pos = 0;
+		file->deny_write = false;
 		return file;
 	}
 	else {
@@ -40,6 +44,7 @@ struct file* file_reopen(struct file* file)
 void file_close(struct file* file)
 {
 	if (file != NULL) {
+		file_allow_write(file);
 		inode_close(file->inode);
 		free(file);
 	}
@@ -99,6 +104,66 @@ off_t file_write_at(struct file* file, const void* buffer, off_t size, off_t fil
 	return inode_write_at(file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from SRC, starting at its current
+	position, to DST, at its current position, and advances both
+	positions by the number of bytes copied, which is returned.
+	That may be less than SIZE at end of SRC, or if DST would have
+	to grow.
+
+	The data moves through a kernel page a chunk at a time and
+	never passes through user memory.  When both positions are
+	sector-aligned, inode_read_at() and inode_write_at() move whole
+	sectors straight between the disk and that page. */
+off_t file_copy(struct file* dst, struct file* src, off_t size)
+{
+	uint8_t sector_buf[BLOCK_SECTOR_SIZE];
+	uint8_t* buf = palloc_get_page(0);
+	off_t buf_size = buf != NULL ? PGSIZE : BLOCK_SECTOR_SIZE;
+	off_t copied = 0;
+
+	if (buf == NULL)
+		buf = sector_buf;
+
+	while (copied < size) {
+		off_t chunk = size - copied < buf_size ? size - copied : buf_size;
+		off_t bytes_read = inode_read_at(src->inode, buf, chunk, src->pos);
+		off_t bytes_written = inode_write_at(dst->inode, buf, bytes_read, dst->pos);
+
+		src->pos += bytes_written;
+		dst->pos += bytes_written;
+		copied += bytes_written;
+		if (bytes_read < chunk || bytes_written < bytes_read)
+			break;
+	}
+
+	if (buf != sector_buf)
+		palloc_free_page(buf);
+	return copied;
+}
+
+/* Prevents write operations on FILE's underlying inode
+	until file_allow_write() is called or FILE is closed. */
+void file_deny_write(struct file* file)
+{
+	ASSERT(file != NULL);
+	if (!file->deny_write) {
+		file->deny_write = true;
+		inode_deny_write(file->inode);
+	}
+}
+
+/* Re-enables write operations on FILE's underlying inode.
+	(Writes might still be denied by some other file that has the
+	same inode open.) */
+void file_allow_write(struct file* file)
+{
+	ASSERT(file != NULL);
+	if (file->deny_write) {
+		file->deny_write = false;
+		inode_allow_write(file->inode);
+	}
+}
+
 /* Returns the size of FILE in bytes. */
 off_t file_length(struct file* file)
 {
@@ -13,11 +13,8 @@
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
-struct synch {
-	int readcount;
-	struct semaphore synch_sema;
-	struct lock synch_lock;
-};
+/* Most sectors inode_read_at() reads with one request. */
+#define READ_RUN_MAX 64
 
 /* On-disk inode.
 	Must be exactly BLOCK_SECTOR_SIZE bytes long. */
@@ -42,9 +39,39 @@ struct inode {
 	int open_cnt;				/* Number of openers. */
 	bool removed;				/* True if deleted, false otherwise. */
 	struct inode_disk data; /* Inode content. */
-	struct synch synch;		/* Synchronize read-write */
+	struct lock ranges_lock;	/* Protects RANGES. */
+	struct list ranges;		/* Locked and waiting sector ranges. */
+	int deny_write_cnt;		/* 0: writes ok, >0: deny writes. */
+	struct rwlock deny_rw;	/* Writers hold it to read, deniers to write. */
+};
+
+/* A range of sectors of an inode, locked for reading or writing.
+	Operations on disjoint ranges of one inode run in parallel;
+	overlapping ranges exclude each other unless both are reads.
+
+	Ranges are kept in arrival order and a range is only granted
+	once no earlier range (granted or still waiting) conflicts
+	with it, so a writer is never starved by a stream of readers
+	of the same sectors, and vice versa.
+
+	Ranges replace the whole-inode reader-writer lock as the guard
+	on file data, since it kept writers to different parts of a file
+	apart.  The rwlock now guards only what concerns the inode as a
+	whole: each write holds DENY_RW for reading, so writes still run
+	side by side, and inode_deny_write() takes it for writing to
+	wait out the writes in progress.  Its writer preference keeps a
+	stream of writes from holding off a process being loaded. */
+struct inode_range {
+	struct list_elem elem;	 /* Element in inode's RANGES. */
+	size_t first, last;		 /* First and last sector index, inclusive. */
+	bool write;					 /* Exclusive? */
+	bool granted;				 /* Has it been granted yet? */
+	struct semaphore ready;	 /* Up'd when granted. */
 };
 
+static bool range_lock(struct inode*, struct inode_range*, off_t size, off_t offset, bool write);
+static void range_unlock(struct inode*, struct inode_range*);
+
 /* Returns the block device sector that contains byte offset POS
 	within INODE.
 	Returns -1 if INODE does not contain data for a byte at offset
@@ -67,7 +94,7 @@ static struct lock list_lock;
 void inode_init(void)
 {
 	list_init(&open_inodes);
-	lock_init(&list_lock);
+	lock_init_named(&list_lock, "inode list");
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -131,10 +158,13 @@ struct inode* inode_open(block_sector_t sector)
 	if (inode == NULL)
 		return NULL;
 
-	/* Initialize main synch mechanism */
-	sema_init(&inode->synch.synch_sema, 1);
-	lock_init(&inode->synch.synch_lock);
-	inode->synch.readcount = 0;
+	/* Initialize range locking. */
+	lock_init_named(&inode->ranges_lock, "inode ranges");
+	list_init(&inode->ranges);
+
+	/* Writes are allowed until someone denies them. */
+	inode->deny_write_cnt = 0;
+	rwlock_init(&inode->deny_rw);
 
 	/* Initialize. */
 	list_push_front(&open_inodes, &inode->elem);
@@ -202,19 +232,13 @@ void inode_remove(struct inode* inode)
 	than SIZE if an error occurs or end of file is reached. */
 off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset)
 {
-
-	// -- Synchronize
-	lock_acquire(&inode->synch.synch_lock);	// Lock other processes from changing readcount value
-	inode->synch.readcount++;	// Increment readcount
-	if (inode->synch.readcount == 1) {	// If we are first reader,
-		sema_down(&inode->synch.synch_sema);	// Then signal writers that they can't write to inode
-	}
-	lock_release(&inode->synch.synch_lock);	// Allow other processes to adjust readcount value
-
-
 	uint8_t* buffer = buffer_;
 	off_t bytes_read = 0;
 	uint8_t* bounce = NULL;
+	struct inode_range range;
+
+	if (!range_lock(inode, &range, size, offset, false))
+		return 0;
 
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
@@ -232,8 +256,20 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
 			break;
 
 		if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			block_read(fs_device, sector_idx, buffer + bytes_read);
+			/* Read a run of full sectors directly into caller's
+				buffer.  The file's sectors are contiguous, so the
+				run is a single multi-sector read. */
+			void* sectors[READ_RUN_MAX];
+			off_t left = size < inode_left ? size : inode_left;
+			size_t run = left / BLOCK_SECTOR_SIZE;
+			size_t i;
+
+			if (run > READ_RUN_MAX)
+				run = READ_RUN_MAX;
+			for (i = 0; i < run; i++)
+				sectors[i] = buffer + bytes_read + i * BLOCK_SECTOR_SIZE;
+			block_read_multiple(fs_device, sector_idx, run, sectors);
+			chunk_size = run * BLOCK_SECTOR_SIZE;
 		}
 		else {
 			/* Read sector into bounce buffer, then partially copy
@@ -254,31 +290,31 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
 	}
 	free(bounce);
 
-	// -- Synchronize
-	lock_acquire(&inode->synch.synch_lock);	// Lock other processes from changing readcount value
-	inode->synch.readcount--;	// Decrement readcount
-	if (inode->synch.readcount == 0) {	// If we are last reader,
-		sema_up(&inode->synch.synch_sema);	// Then signal writers that they are allowed to write to inode
-	}
-	lock_release(&inode->synch.synch_lock);	// Allow other processes to adjust readcount value
+	range_unlock(inode, &range);
 
 	return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
 	Returns the number of bytes actually written, which may be
-	less than SIZE if end of file is reached or an error occurs.
+	less than SIZE if end of file is reached or an error occurs,
+	or 0 if writes to INODE are denied.
 	(Normally a write at end of file would extend the inode, but
 	growth is not yet implemented.) */
 off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t offset)
 {
-
-	// -- Synchronize
-	sema_down(&inode->synch.synch_sema);	// Wait for readers to finish reading
-
 	const uint8_t* buffer = buffer_;
 	off_t bytes_written = 0;
 	uint8_t* bounce = NULL;
+	struct inode_range range;
+
+	/* Held for reading across the write, so that inode_deny_write()
+		waits for writes already under way. */
+	rwlock_acquire_read(&inode->deny_rw);
+	if (inode->deny_write_cnt > 0 || !range_lock(inode, &range, size, offset, true)) {
+		rwlock_release_read(&inode->deny_rw);
+		return 0;
+	}
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -325,14 +361,102 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
 	}
 	free(bounce);
 
-	// -- Synchronization
-	sema_up(&inode->synch.synch_sema);	// Up sema to signal completion of writing
+	range_unlock(inode, &range);
+	rwlock_release_read(&inode->deny_rw);
 
 	return bytes_written;
 }
 
+/* Disables writes to INODE.
+	May be called at most once per inode opener.
+	Returns only once no write to INODE is in progress. */
+void inode_deny_write(struct inode* inode)
+{
+	rwlock_acquire_write(&inode->deny_rw);
+	inode->deny_write_cnt++;
+	ASSERT(inode->deny_write_cnt <= inode->open_cnt);
+	rwlock_release_write(&inode->deny_rw);
+}
+
+/* Re-enables writes to INODE.
+	Must be called once by each inode opener who has called
+	inode_deny_write() on the inode, before closing the inode. */
+void inode_allow_write(struct inode* inode)
+{
+	rwlock_acquire_write(&inode->deny_rw);
+	ASSERT(inode->deny_write_cnt > 0);
+	ASSERT(inode->deny_write_cnt <= inode->open_cnt);
+	inode->deny_write_cnt--;
+	rwlock_release_write(&inode->deny_rw);
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t inode_length(const struct inode* inode)
 {
 	return inode->data.length;
 }
+
+/* Returns true if R conflicts with any range queued before it on
+	INODE. */
+static bool range_blocked(struct inode* inode, struct inode_range* r)
+{
+	struct list_elem* e;
+
+	ASSERT(lock_held_by_current_thread(&inode->ranges_lock));
+
+	for (e = list_begin(&inode->ranges); e != &r->elem; e = list_next(e)) {
+		struct inode_range* o = list_entry(e, struct inode_range, elem);
+		if ((o->write || r->write) && o->first <= r->last && r->first <= o->last)
+			return true;
+	}
+	return false;
+}
+
+/* Locks the sectors of INODE touched by SIZE bytes at OFFSET,
+	for writing if WRITE is true, otherwise for reading, sleeping
+	until no conflicting range is ahead of us.  R is filled in and
+	must be passed to range_unlock() later.  Returns false, without
+	locking anything, if the range lies entirely past the end of
+	INODE. */
+static bool range_lock(
+	 struct inode* inode, struct inode_range* r, off_t size, off_t offset, bool write)
+{
+	off_t end = offset + size;
+
+	if (end > inode_length(inode))
+		end = inode_length(inode);
+	if (size <= 0 || offset >= end)
+		return false;
+
+	r->first = offset / BLOCK_SECTOR_SIZE;
+	r->last = (end - 1) / BLOCK_SECTOR_SIZE;
+	r->write = write;
+	sema_init(&r->ready, 0);
+
+	lock_acquire(&inode->ranges_lock);
+	list_push_back(&inode->ranges, &r->elem);
+	r->granted = !range_blocked(inode, r);
+	lock_release(&inode->ranges_lock);
+
+	if (!r->granted)
+		sema_down(&r->ready);
+	return true;
+}
+
+/* Unlocks range R of INODE and grants any waiting ranges that no
+	longer conflict with anything ahead of them. */
+static void range_unlock(struct inode* inode, struct inode_range* r)
+{
+	struct list_elem* e;
+
+	lock_acquire(&inode->ranges_lock);
+	list_remove(&r->elem);
+	for (e = list_begin(&inode->ranges); e != list_end(&inode->ranges); e = list_next(e)) {
+		struct inode_range* w = list_entry(e, struct inode_range, elem);
+		if (!w->granted && !range_blocked(inode, w)) {
+			w->granted = true;
+			sema_up(&w->ready);
+		}
+	}
+	lock_release(&inode->ranges_lock);
+}
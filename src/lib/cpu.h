@@ -0,0 +1,69 @@
+#ifndef __LIB_CPU_H
+#define __LIB_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* CPUID leaf 1, EDX feature bits. */
+#define CPUID_1_EDX_PSE (1u << 3)  /* 4 MB pages. */
+#define CPUID_1_EDX_SEP (1u << 11) /* SYSENTER/SYSEXIT present. */
+#define CPUID_1_EDX_PGE (1u << 13) /* Global pages. */
+
+/* Executes CPUID for LEAF and stores the resulting registers in
+	*EAX, *EBX, *ECX, and *EDX. */
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx,
+								 uint32_t* ecx, uint32_t* edx)
+{
+	asm volatile("cpuid"
+					 : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+					 : "a"(leaf), "c"(0));
+}
+
+/* Returns true if the CPU reports all of the CPUID leaf 1 EDX
+	feature bits in FEATURES. */
+static inline bool cpu_has_features(uint32_t features)
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid(1, &eax, &ebx, &ecx, &edx);
+	return (edx & features) == features;
+}
+
+/* Returns true if the CPU supports the SYSENTER and SYSEXIT
+	instructions.  Early Pentium Pro parts (family 6, model < 3,
+	stepping < 3) set the SEP bit without actually implementing
+	the instructions, so they are excluded; see [IA32-v2b]
+	"SYSENTER". */
+static inline bool cpu_has_sysenter(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+	unsigned family, model, stepping;
+
+	cpuid(1, &eax, &ebx, &ecx, &edx);
+	if (!(edx & CPUID_1_EDX_SEP))
+		return false;
+
+	family = (eax >> 8) & 0xf;
+	model = (eax >> 4) & 0xf;
+	stepping = eax & 0xf;
+	return !(family == 6 && model < 3 && stepping < 3);
+}
+
+/* Returns the processor's time-stamp counter. */
+static inline uint64_t rdtsc(void)
+{
+	uint32_t lo, hi;
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/* Writes VALUE to model-specific register MSR.
+	Privileged: kernel only. */
+static inline void wrmsr(uint32_t msr, uint64_t value)
+{
+	asm volatile("wrmsr"
+					 :
+					 : "c"(msr), "a"((uint32_t) value), "d"((uint32_t) (value >> 32)));
+}
+
+#endif /* lib/cpu.h */
@@ -0,0 +1,122 @@
+#ifndef __LIB_IORING_H
+#define __LIB_IORING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Asynchronous I/O rings, shared between a user process and the
+	kernel.  See userprog/ioring.c for the kernel side.
+
+	A process maps a ring with ioring_setup().  The mapping starts
+	with a struct ioring_hdr, followed by SQ_ENTRIES submission
+	queue entries and CQ_ENTRIES completion queue entries at the
+	offsets given in the header.  The process fills in submission
+	entries and advances SQ_TAIL, then calls ioring_enter() to hand
+	them to the kernel, which advances SQ_HEAD as it takes them.
+	The kernel posts completions, in whatever order requests
+	finish, and advances CQ_TAIL; the process consumes them and
+	advances CQ_HEAD.  All four indexes count up forever and are
+	reduced modulo the queue size (a power of 2) when used. */
+
+/* Submission queue operations. */
+enum ioring_op {
+	IORING_OP_NOP,	  /* Do nothing; completes with 0. */
+	IORING_OP_READ,  /* pread(FD, ADDR, LEN, OFFSET). */
+	IORING_OP_WRITE, /* pwrite(FD, ADDR, LEN, OFFSET). */
+	IORING_OP_OPEN,  /* open(ADDR). */
+	IORING_OP_CLOSE  /* close(FD). */
+};
+
+/* Maximum number of submission queue entries in a ring. */
+#define IORING_MAX_ENTRIES 256
+
+/* A submission queue entry. */
+struct ioring_sqe {
+	uint8_t opcode;	  /* One of enum ioring_op. */
+	uint8_t flags;	  /* Must be zero. */
+	uint16_t reserved;  /* Must be zero. */
+	int32_t fd;			  /* File descriptor. */
+	void* addr;			  /* Buffer, or file name for IORING_OP_OPEN. */
+	uint32_t len;		  /* Buffer size. */
+	uint32_t offset;	  /* File offset. */
+	uint32_t user_data; /* Copied to the completion. */
+};
+
+/* A completion queue entry. */
+struct ioring_cqe {
+	uint32_t user_data; /* From the submission entry. */
+	int32_t res;		  /* Result, as the equivalent system call. */
+};
+
+/* Ring header, at the start of the shared mapping. */
+struct ioring_hdr {
+	volatile uint32_t sq_head; /* Next entry the kernel takes. */
+	volatile uint32_t sq_tail; /* Next entry the process fills. */
+	volatile uint32_t cq_head; /* Next completion the process reads. */
+	volatile uint32_t cq_tail; /* Next completion the kernel posts. */
+	uint32_t sq_entries;			/* Submission queue size. */
+	uint32_t cq_entries;			/* Completion queue size. */
+	uint32_t sqes_off;			/* Offset of submission entries. */
+	uint32_t cqes_off;			/* Offset of completion entries. */
+};
+
+/* Keeps the compiler from moving memory accesses across it.
+	x86 does not reorder stores with other stores or loads with
+	other loads, so that is all the ring protocol needs. */
+#define ioring_barrier() asm volatile("" : : : "memory")
+
+/* Returns the number of bytes mapped for a ring with ENTRIES
+	submission queue entries. */
+static inline size_t ioring_size(uint32_t entries)
+{
+	return sizeof(struct ioring_hdr) + entries * sizeof(struct ioring_sqe)
+			 + 2 * entries * sizeof(struct ioring_cqe);
+}
+
+/* Returns ring H's submission queue entries. */
+static inline struct ioring_sqe* ioring_sqes(struct ioring_hdr* h)
+{
+	return (struct ioring_sqe*) ((uint8_t*) h + h->sqes_off);
+}
+
+/* Returns ring H's completion queue entries. */
+static inline struct ioring_cqe* ioring_cqes(struct ioring_hdr* h)
+{
+	return (struct ioring_cqe*) ((uint8_t*) h + h->cqes_off);
+}
+
+/* Returns the next free submission entry in H, or a null pointer
+	if the submission queue is full.  The entry is not handed to
+	the kernel until ioring_commit_sqe(). */
+static inline struct ioring_sqe* ioring_get_sqe(struct ioring_hdr* h)
+{
+	if (h->sq_tail - h->sq_head >= h->sq_entries)
+		return NULL;
+	return &ioring_sqes(h)[h->sq_tail & (h->sq_entries - 1)];
+}
+
+/* Publishes the entry returned by ioring_get_sqe(). */
+static inline void ioring_commit_sqe(struct ioring_hdr* h)
+{
+	ioring_barrier();
+	h->sq_tail++;
+}
+
+/* Returns the oldest unconsumed completion in H, or a null
+	pointer if there is none. */
+static inline struct ioring_cqe* ioring_peek_cqe(struct ioring_hdr* h)
+{
+	if (h->cq_head == h->cq_tail)
+		return NULL;
+	ioring_barrier();
+	return &ioring_cqes(h)[h->cq_head & (h->cq_entries - 1)];
+}
+
+/* Marks the completion returned by ioring_peek_cqe() consumed. */
+static inline void ioring_cqe_seen(struct ioring_hdr* h)
+{
+	ioring_barrier();
+	h->cq_head++;
+}
+
+#endif /* lib/ioring.h */
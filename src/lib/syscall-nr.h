@@ -29,6 +29,18 @@ enum {
 	SYS_READDIR, /* Reads a directory entry. */
 	SYS_ISDIR,	 /* Tests if a fd represents a directory. */
 	SYS_INUMBER, /* Returns the inode number for a fd. */
+
+	/* Extensions. */
+	SYS_GETPID, /* Return the caller's process id. */
+	SYS_PREAD,	/* Read from a file at a given offset. */
+	SYS_PWRITE, /* Write to a file at a given offset. */
+	SYS_READV,	/* Read from a file into several buffers. */
+	SYS_WRITEV, /* Write to a file from several buffers. */
+	SYS_IORING_SETUP, /* Map an asynchronous I/O ring. */
+	SYS_IORING_ENTER, /* Submit to and wait on the I/O ring. */
+	SYS_COPY_FILE_RANGE, /* Copy data between files in the kernel. */
+	SYS_PIPE, /* Create an anonymous pipe. */
+	SYS_SBRK, /* Grow or shrink the heap. */
     SYS_NUMBER_OF_CALLS /* Needs to be last to be correct */
 };
 
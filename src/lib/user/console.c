@@ -7,7 +7,7 @@
 	which is like printf() but uses a va_list. */
 int vprintf(const char* format, va_list args)
 {
-	return vhprintf(STDOUT_FILENO, format, args);
+	return vfprintf(stdout, format, args);
 }
 
 /* Like printf(), but writes output to the given HANDLE. */
@@ -23,22 +23,19 @@ int hprintf(int handle, const char* format, ...)
 	return retval;
 }
 
-/* Writes string S to the console, followed by a new-line
+/* Writes string S to stdout, followed by a new-line
 	character. */
 int puts(const char* s)
 {
-	write(STDOUT_FILENO, s, strlen(s));
-	putchar('\n');
-
+	if (fputs(s, stdout) == EOF || fputc('\n', stdout) == EOF)
+		return EOF;
 	return 0;
 }
 
-/* Writes C to the console. */
+/* Writes C to stdout. */
 int putchar(int c)
 {
-	char c2 = c;
-	write(STDOUT_FILENO, &c2, 1);
-	return c;
+	return fputc(c, stdout);
 }
 
 /* Auxiliary data for vhprintf_helper(). */
@@ -54,10 +51,12 @@ static void flush(struct vhprintf_aux*);
 
 /* Formats the printf() format specification FORMAT with
 	arguments given in ARGS and writes the output to the given
-	HANDLE. */
+	HANDLE, bypassing the stdio buffers.  Flushes stdout first, so
+	that output to the console stays in order. */
 int vhprintf(int handle, const char* format, va_list args)
 {
 	struct vhprintf_aux aux;
+	fflush(stdout);
 	aux.p = aux.buf;
 	aux.char_cnt = 0;
 	aux.handle = handle;
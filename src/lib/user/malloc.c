@@ -0,0 +1,339 @@
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* User heap allocator.
+
+	Memory comes from the kernel with sbrk(), which maps zeroed
+	pages at the end of the heap.  Programs that use malloc() must
+	not move the break themselves.
+
+	Requests of up to SMALL_MAX bytes, counting an 8-byte header,
+	are rounded up to a power of 2 and served from per-class free
+	lists.  A class with an empty list takes a RUN_SIZE run from
+	the large allocator and carves it into blocks; freed blocks go
+	back on their class's list and are never merged.  A process
+	has a single thread, so the lists need no locking; they are
+	the process's own, like per-thread caches in a threaded
+	allocator.
+
+	Larger requests are chunks carved first-fit from the heap.
+	Every chunk records its physical predecessor, so a freed chunk
+	is merged at once with free neighbours on both sides, and two
+	free chunks are never adjacent.  A free chunk at the end of the
+	heap that grows past TRIM_SIZE is handed back to the kernel. */
+
+/* Header at the start of every block and chunk. */
+struct chunk {
+	struct chunk* prev; /* Physically preceding large chunk, or null. */
+	size_t size;		  /* Size including this header, plus CHUNK_* flags. */
+};
+
+#define CHUNK_USED 1	 /* Allocated. */
+#define CHUNK_SMALL 2 /* Small block, not a large chunk. */
+#define CHUNK_FLAGS 7 /* All flag bits; sizes are multiples of 8. */
+
+#define HDR_SIZE sizeof(struct chunk)
+
+/* Small blocks. */
+#define SMALL_MIN 16		/* Smallest class, counting the header. */
+#define SMALL_MAX 1024	/* Largest class, counting the header. */
+#define CLASS_CNT 7		/* Classes 16, 32, ..., SMALL_MAX. */
+#define RUN_SIZE 4096	/* Bytes carved at once into small blocks. */
+
+/* Large chunks. */
+#define MIN_SPLIT 64					/* Smallest remainder worth splitting off. */
+#define GROW_SIZE 16384				/* Least the heap grows by. */
+#define TRIM_SIZE (64 * 1024)		/* Free space at the end given back. */
+
+/* A free small block. */
+struct free_block {
+	struct free_block* next;
+};
+
+/* Links in a free large chunk, just after its header. */
+struct free_links {
+	struct chunk* next;
+	struct chunk* prev;
+};
+
+static struct free_block* small_free[CLASS_CNT]; /* Per-class free lists. */
+static struct chunk* large_free;						 /* Free large chunks. */
+static struct chunk* last;								 /* Physically last chunk. */
+
+static size_t chunk_size(const struct chunk* c)
+{
+	return c->size & ~(size_t) CHUNK_FLAGS;
+}
+
+static struct free_links* links(struct chunk* c)
+{
+	return (struct free_links*) (c + 1);
+}
+
+/* Returns the chunk physically after C, or a null pointer if C
+	is the last. */
+static struct chunk* next_chunk(struct chunk* c)
+{
+	return c == last ? NULL : (struct chunk*) ((uint8_t*) c + chunk_size(c));
+}
+
+/* Adds free chunk C to the free list. */
+static void list_insert(struct chunk* c)
+{
+	links(c)->prev = NULL;
+	links(c)->next = large_free;
+	if (large_free != NULL)
+		links(large_free)->prev = c;
+	large_free = c;
+}
+
+/* Removes free chunk C from the free list. */
+static void list_remove(struct chunk* c)
+{
+	struct free_links* l = links(c);
+
+	if (l->prev != NULL)
+		links(l->prev)->next = l->next;
+	else
+		large_free = l->next;
+	if (l->next != NULL)
+		links(l->next)->prev = l->prev;
+}
+
+/* Shrinks chunk C to SIZE bytes if enough is left over to make a
+	useful free chunk of the rest, which goes on the free list. */
+static void split(struct chunk* c, size_t size)
+{
+	size_t rest_size = chunk_size(c) - size;
+	struct chunk* rest;
+
+	if (rest_size < MIN_SPLIT)
+		return;
+
+	rest = (struct chunk*) ((uint8_t*) c + size);
+	rest->prev = c;
+	rest->size = rest_size;
+	if (c == last)
+		last = rest;
+	else
+		next_chunk(rest)->prev = rest;
+	c->size = size | (c->size & CHUNK_FLAGS);
+	list_insert(rest);
+}
+
+/* Gets at least SIZE more bytes from the kernel and returns them
+	as a free chunk, not on the free list, merged with the last
+	chunk if that is free.  Returns a null pointer if the kernel
+	refuses. */
+static struct chunk* grow_heap(size_t size)
+{
+	struct chunk* c;
+	size_t have = 0;
+	size_t grow;
+
+	if (last != NULL && !(last->size & CHUNK_USED))
+		have = chunk_size(last);
+	grow = ROUND_UP(size - have, GROW_SIZE);
+	if ((int) grow < 0)
+		return NULL;
+
+	c = sbrk(grow);
+	if (c == (void*) -1)
+		return NULL;
+
+	if (have > 0) {
+		c = last;
+		list_remove(c);
+		c->size += grow;
+	} else {
+		c->prev = last;
+		c->size = grow;
+		last = c;
+	}
+	return c;
+}
+
+/* Allocates a large chunk of SIZE bytes, counting the header. */
+static struct chunk* large_alloc(size_t size)
+{
+	struct chunk* c;
+
+	for (c = large_free; c != NULL; c = links(c)->next)
+		if (chunk_size(c) >= size) {
+			list_remove(c);
+			break;
+		}
+	if (c == NULL && (c = grow_heap(size)) == NULL)
+		return NULL;
+
+	split(c, size);
+	c->size |= CHUNK_USED;
+	return c;
+}
+
+/* Frees large chunk C, merging it with free neighbours, and gives
+	a large enough free tail back to the kernel. */
+static void large_free_chunk(struct chunk* c)
+{
+	struct chunk* next = next_chunk(c);
+
+	c->size &= ~(size_t) CHUNK_USED;
+
+	if (next != NULL && !(next->size & CHUNK_USED)) {
+		list_remove(next);
+		c->size += chunk_size(next);
+		if (next == last)
+			last = c;
+		else
+			next_chunk(c)->prev = c;
+	}
+	if (c->prev != NULL && !(c->prev->size & CHUNK_USED)) {
+		struct chunk* prev = c->prev;
+		list_remove(prev);
+		prev->size += chunk_size(c);
+		if (c == last)
+			last = prev;
+		else
+			next_chunk(prev)->prev = prev;
+		c = prev;
+	}
+
+	if (c == last && chunk_size(c) >= TRIM_SIZE) {
+		size_t release = ROUND_DOWN(chunk_size(c) - GROW_SIZE, RUN_SIZE);
+		if (sbrk(-(int) release) != (void*) -1)
+			c->size -= release;
+	}
+	list_insert(c);
+}
+
+/* Returns the class index for a small block of SIZE bytes,
+	counting the header. */
+static int size_class(size_t size)
+{
+	int cls = 0;
+
+	while ((size_t) SMALL_MIN << cls < size)
+		cls++;
+	return cls;
+}
+
+/* Refills the free list for class CLS from a new run.  Returns
+	false if memory is exhausted. */
+static bool refill(int cls)
+{
+	size_t size = (size_t) SMALL_MIN << cls;
+	struct chunk* run = large_alloc(HDR_SIZE + RUN_SIZE);
+	uint8_t* p;
+
+	if (run == NULL)
+		return false;
+	for (p = (uint8_t*) (run + 1); p + size <= (uint8_t*) (run + 1) + RUN_SIZE; p += size) {
+		struct chunk* b = (struct chunk*) p;
+		struct free_block* fb = (struct free_block*) (b + 1);
+
+		b->prev = NULL;
+		b->size = size | CHUNK_SMALL;
+		fb->next = small_free[cls];
+		small_free[cls] = fb;
+	}
+	return true;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+	Returns a null pointer if memory is not available. */
+void* malloc(size_t size)
+{
+	size_t need;
+	struct chunk* c;
+
+	if (size > SIZE_MAX - HDR_SIZE - 8)
+		return NULL;
+	need = ROUND_UP(HDR_SIZE + (size > 0 ? size : 1), 8);
+
+	if (need <= SMALL_MAX) {
+		int cls = size_class(need);
+		struct free_block* fb;
+
+		if (small_free[cls] == NULL && !refill(cls))
+			return NULL;
+		fb = small_free[cls];
+		small_free[cls] = fb->next;
+		c = (struct chunk*) fb - 1;
+		c->size |= CHUNK_USED;
+		return c + 1;
+	}
+
+	c = large_alloc(need);
+	return c != NULL ? c + 1 : NULL;
+}
+
+/* Frees block P, which must have been previously allocated with
+	malloc(), calloc(), or realloc(). */
+void free(void* p)
+{
+	struct chunk* c;
+
+	if (p == NULL)
+		return;
+	c = (struct chunk*) p - 1;
+	ASSERT(c->size & CHUNK_USED);
+
+	if (c->size & CHUNK_SMALL) {
+		struct free_block* fb = p;
+		int cls = size_class(chunk_size(c));
+
+		c->size &= ~(size_t) CHUNK_USED;
+		fb->next = small_free[cls];
+		small_free[cls] = fb;
+	} else {
+		large_free_chunk(c);
+	}
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+	Returns a null pointer if memory is not available. */
+void* calloc(size_t a, size_t b)
+{
+	void* p;
+
+	if (b != 0 && a > SIZE_MAX / b)
+		return NULL;
+	p = malloc(a * b);
+	if (p != NULL)
+		memset(p, 0, a * b);
+	return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly moving
+	it in the process.  If successful, returns the new block; on
+	failure, returns a null pointer and leaves OLD_BLOCK alone.  A
+	call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).  A
+	call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void* realloc(void* old_block, size_t new_size)
+{
+	void* new_block;
+	size_t old_size;
+
+	if (new_size == 0) {
+		free(old_block);
+		return NULL;
+	}
+	if (old_block == NULL)
+		return malloc(new_size);
+
+	old_size = chunk_size((struct chunk*) old_block - 1) - HDR_SIZE;
+	if (new_size <= old_size)
+		return old_block;
+
+	new_block = malloc(new_size);
+	if (new_block != NULL) {
+		memcpy(new_block, old_block, old_size);
+		free(old_block);
+	}
+	return new_block;
+}
@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Buffered streams.
+
+	Each stream collects output in its buffer and hands it to the
+	kernel in one write() when the buffer fills, when a line ends
+	if the stream is line buffered, or on fflush().  Input is read
+	a buffer at a time in the same way; the kernel returns console
+	input a line at a time, so a line-buffered stdin sees each line
+	as soon as it is entered.
+
+	Streams and their buffers come from fixed tables rather than
+	malloc(), so stdio keeps working when sbrk() fails and does not
+	grow the heap of programs that never call malloc().  stdin and stdout are line buffered; streams from
+	fopen() and fdopen() are fully buffered.  exit() flushes every
+	stream. */
+
+/* Stream flags. */
+#define F_READ 0x01	/* Open for reading. */
+#define F_WRITE 0x02 /* Open for writing. */
+#define F_EOF 0x04	/* End of file seen. */
+#define F_ERR 0x08	/* I/O error seen. */
+
+/* A stream. */
+struct FILE {
+	int fd;		  /* Underlying file descriptor. */
+	int flags;	  /* F_* flags, 0 if the slot is free. */
+	int mode;	  /* _IOFBF, _IOLBF, or _IONBF. */
+	char* buf;	  /* Buffer. */
+	size_t size; /* Capacity of BUF. */
+	size_t pos;	  /* Next byte to read, or number of bytes to write. */
+	size_t len;	  /* Number of bytes in BUF, when reading. */
+};
+
+static char buffers[FOPEN_MAX][BUFSIZ];
+
+static FILE files[FOPEN_MAX] = {
+	{STDIN_FILENO, F_READ, _IOLBF, buffers[0], BUFSIZ, 0, 0},
+	{STDOUT_FILENO, F_WRITE, _IOLBF, buffers[1], BUFSIZ, 0, 0},
+};
+
+FILE* stdin = &files[0];
+FILE* stdout = &files[1];
+
+/* Returns the F_READ or F_WRITE flag for fopen() MODE "r" or
+	"w", or 0 for any other mode. */
+static int parse_mode(const char* mode)
+{
+	if (!strcmp(mode, "r"))
+		return F_READ;
+	if (!strcmp(mode, "w"))
+		return F_WRITE;
+	return 0;
+}
+
+/* Returns a stream for open file descriptor FD, to be used as
+	MODE says, or a null pointer if MODE is bad or FOPEN_MAX
+	streams are already open. */
+FILE* fdopen(int fd, const char* mode)
+{
+	int flags = parse_mode(mode);
+	int i;
+
+	if (flags == 0 || fd < 0)
+		return NULL;
+	for (i = 0; i < FOPEN_MAX; i++) {
+		FILE* fp = &files[i];
+		if (fp->flags == 0) {
+			fp->fd = fd;
+			fp->flags = flags;
+			fp->mode = _IOFBF;
+			fp->buf = buffers[i];
+			fp->size = BUFSIZ;
+			fp->pos = fp->len = 0;
+			return fp;
+		}
+	}
+	return NULL;
+}
+
+/* Opens file NAME as a stream, to be used as MODE says: "r" for
+	reading or "w" for writing from the start of the file.  Returns
+	a null pointer on failure. */
+FILE* fopen(const char* name, const char* mode)
+{
+	FILE* fp;
+	int fd;
+
+	if (parse_mode(mode) == 0)
+		return NULL;
+	fd = open(name);
+	if (fd < 0)
+		return NULL;
+	fp = fdopen(fd, mode);
+	if (fp == NULL)
+		close(fd);
+	return fp;
+}
+
+/* Writes out whatever FP has buffered.  Returns 0 if successful,
+	EOF on error. */
+static int flush_stream(FILE* fp)
+{
+	size_t done = 0;
+
+	while (done < fp->pos) {
+		int n = write(fp->fd, fp->buf + done, fp->pos - done);
+		if (n <= 0) {
+			fp->flags |= F_ERR;
+			fp->pos = 0;
+			return EOF;
+		}
+		done += n;
+	}
+	fp->pos = 0;
+	return 0;
+}
+
+/* Writes out FP's buffered output, or that of every output
+	stream if FP is a null pointer.  Buffered input is left alone.
+	Returns 0 if successful, EOF on error. */
+int fflush(FILE* fp)
+{
+	int result = 0;
+	int i;
+
+	if (fp != NULL)
+		return fp->flags & F_WRITE ? flush_stream(fp) : 0;
+
+	for (i = 0; i < FOPEN_MAX; i++)
+		if (files[i].flags & F_WRITE)
+			if (flush_stream(&files[i]) != 0)
+				result = EOF;
+	return result;
+}
+
+/* Flushes and closes FP.  The console descriptors stay open.
+	Returns 0 if successful, EOF on error. */
+int fclose(FILE* fp)
+{
+	int result = fflush(fp);
+
+	if (fp->fd > STDOUT_FILENO)
+		close(fp->fd);
+	fp->flags = 0;
+	return result;
+}
+
+/* Sets FP's buffering MODE.  If BUF is not null, FP uses its
+	SIZE bytes as its buffer from now on; otherwise FP keeps its
+	own buffer, using at most SIZE bytes of it, or all of it if
+	SIZE is 0.  Must be called before any I/O on FP.  Returns 0
+	if successful, nonzero if MODE is bad. */
+int setvbuf(FILE* fp, char* buf, int mode, size_t size)
+{
+	if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+		return EOF;
+
+	fp->mode = mode;
+	if (buf != NULL && size > 0) {
+		fp->buf = buf;
+		fp->size = size;
+	} else if (size > 0) {
+		fp->size = size < BUFSIZ ? size : BUFSIZ;
+	}
+	return 0;
+}
+
+/* Returns FP's file descriptor. */
+int fileno(FILE* fp)
+{
+	return fp->fd;
+}
+
+/* Returns nonzero if FP has reached end of file. */
+int feof(FILE* fp)
+{
+	return (fp->flags & F_EOF) != 0;
+}
+
+/* Returns nonzero if an I/O error occurred on FP. */
+int ferror(FILE* fp)
+{
+	return (fp->flags & F_ERR) != 0;
+}
+
+/* Writes SIZE * CNT bytes from BUF to FP.  Returns the number of
+	whole elements written. */
+size_t fwrite(const void* buf_, size_t size, size_t cnt, FILE* fp)
+{
+	const char* buf = buf_;
+	size_t total = size * cnt;
+	size_t done = 0;
+
+	if (!(fp->flags & F_WRITE) || total == 0)
+		return 0;
+
+	/* Data that would not fit in an empty buffer goes straight to
+		the kernel, after whatever is already buffered. */
+	if (fp->mode == _IONBF || total >= fp->size) {
+		if (flush_stream(fp) != 0)
+			return 0;
+		while (done < total) {
+			int n = write(fp->fd, buf + done, total - done);
+			if (n <= 0) {
+				fp->flags |= F_ERR;
+				break;
+			}
+			done += n;
+		}
+		return done / size;
+	}
+
+	while (done < total) {
+		size_t n = total - done < fp->size - fp->pos ? total - done : fp->size - fp->pos;
+		memcpy(fp->buf + fp->pos, buf + done, n);
+		fp->pos += n;
+		done += n;
+		if (fp->pos == fp->size && flush_stream(fp) != 0)
+			return 0;
+	}
+	if (fp->mode == _IOLBF && memchr(buf, '\n', total) != NULL && flush_stream(fp) != 0)
+		return 0;
+	return cnt;
+}
+
+/* Writes C to FP.  Returns C, or EOF on error. */
+int fputc(int c, FILE* fp)
+{
+	unsigned char ch = c;
+
+	if (!(fp->flags & F_WRITE))
+		return EOF;
+	if (fp->mode == _IONBF)
+		return fwrite(&ch, 1, 1, fp) == 1 ? ch : EOF;
+
+	fp->buf[fp->pos++] = ch;
+	if ((fp->pos == fp->size || (ch == '\n' && fp->mode == _IOLBF))
+		 && flush_stream(fp) != 0)
+		return EOF;
+	return ch;
+}
+
+/* Writes string S to FP, without a trailing new-line.  Returns a
+	nonnegative value, or EOF on error. */
+int fputs(const char* s, FILE* fp)
+{
+	size_t len = strlen(s);
+
+	if (len > 0 && fwrite(s, 1, len, fp) != len)
+		return EOF;
+	return 0;
+}
+
+/* Auxiliary data for vfprintf_helper(). */
+struct vfprintf_aux {
+	FILE* fp;	  /* Output stream. */
+	int char_cnt; /* Characters written so far. */
+};
+
+/* Writes C to the stream in AUX and counts it. */
+static void vfprintf_helper(char c, void* aux_)
+{
+	struct vfprintf_aux* aux = aux_;
+	fputc(c, aux->fp);
+	aux->char_cnt++;
+}
+
+/* Formats FORMAT with ARGS and writes the result to FP.  Returns
+	the number of characters written. */
+int vfprintf(FILE* fp, const char* format, va_list args)
+{
+	struct vfprintf_aux aux = {fp, 0};
+	__vprintf(format, args, vfprintf_helper, &aux);
+	return aux.char_cnt;
+}
+
+/* Like printf(), but writes output to FP. */
+int fprintf(FILE* fp, const char* format, ...)
+{
+	va_list args;
+	int retval;
+
+	va_start(args, format);
+	retval = vfprintf(fp, format, args);
+	va_end(args);
+
+	return retval;
+}
+
+/* Refills FP's buffer.  Before reading the console, flushes
+	stdout, so that a prompt appears before input is awaited.
+	Returns false at end of file or on error. */
+static bool refill(FILE* fp)
+{
+	int n;
+
+	if (fp->fd == STDIN_FILENO)
+		fflush(stdout);
+	n = read(fp->fd, fp->buf, fp->mode == _IONBF ? 1 : fp->size);
+	if (n <= 0) {
+		fp->flags |= n == 0 ? F_EOF : F_ERR;
+		return false;
+	}
+	fp->pos = 0;
+	fp->len = n;
+	return true;
+}
+
+/* Reads and returns one byte from FP, or EOF at end of file or on
+	error. */
+int fgetc(FILE* fp)
+{
+	if (!(fp->flags & F_READ))
+		return EOF;
+	if (fp->pos == fp->len && !refill(fp))
+		return EOF;
+	return (unsigned char) fp->buf[fp->pos++];
+}
+
+/* Returns the next byte from stdin. */
+int getchar(void)
+{
+	return fgetc(stdin);
+}
+
+/* Reads a line from FP into S, which has room for SIZE bytes
+	including the null terminator.  Keeps the new-line, if it
+	fits.  Returns S, or a null pointer if nothing could be read. */
+char* fgets(char* s, int size, FILE* fp)
+{
+	int i = 0;
+
+	if (size <= 0)
+		return NULL;
+	while (i < size - 1) {
+		int c = fgetc(fp);
+		if (c == EOF)
+			break;
+		s[i++] = c;
+		if (c == '\n')
+			break;
+	}
+	if (i == 0)
+		return NULL;
+	s[i] = '\0';
+	return s;
+}
+
+/* Reads up to CNT elements of SIZE bytes each from FP into BUF.
+	Returns the number of whole elements read. */
+size_t fread(void* buf_, size_t size, size_t cnt, FILE* fp)
+{
+	char* buf = buf_;
+	size_t total = size * cnt;
+	size_t done = 0;
+
+	if (!(fp->flags & F_READ) || total == 0)
+		return 0;
+
+	while (done < total) {
+		size_t n;
+
+		if (fp->pos == fp->len) {
+			/* Large reads bypass the buffer once it is empty. */
+			if (total - done >= fp->size && fp->fd != STDIN_FILENO) {
+				int got = read(fp->fd, buf + done, total - done);
+				if (got <= 0) {
+					fp->flags |= got == 0 ? F_EOF : F_ERR;
+					break;
+				}
+				done += got;
+				continue;
+			}
+			if (!refill(fp))
+				break;
+		}
+		n = total - done < fp->len - fp->pos ? total - done : fp->len - fp->pos;
+		memcpy(buf + done, fp->buf + fp->pos, n);
+		fp->pos += n;
+		done += n;
+	}
+	return done / size;
+}
@@ -4,4 +4,48 @@
 int hprintf(int, const char*, ...) PRINTF_FORMAT(2, 3);
 int vhprintf(int, const char*, va_list) PRINTF_FORMAT(2, 0);
 
+/* Buffered streams. */
+typedef struct FILE FILE;
+
+extern FILE* stdin;
+extern FILE* stdout;
+
+#define EOF (-1)
+
+/* Size of a stream's built-in buffer, and the most setvbuf() will
+	use of it. */
+#define BUFSIZ 512
+
+/* Maximum number of streams open at once, counting stdin and
+	stdout. */
+#define FOPEN_MAX 8
+
+/* Buffering modes for setvbuf(). */
+#define _IOFBF 0 /* Fully buffered. */
+#define _IOLBF 1 /* Line buffered. */
+#define _IONBF 2 /* Unbuffered. */
+
+FILE* fopen(const char* name, const char* mode);
+FILE* fdopen(int fd, const char* mode);
+int fclose(FILE*);
+int fflush(FILE*);
+int setvbuf(FILE*, char* buf, int mode, size_t size);
+int fileno(FILE*);
+int feof(FILE*);
+int ferror(FILE*);
+
+int fputc(int, FILE*);
+int fputs(const char*, FILE*);
+size_t fwrite(const void*, size_t size, size_t cnt, FILE*);
+int fprintf(FILE*, const char*, ...) PRINTF_FORMAT(2, 3);
+int vfprintf(FILE*, const char*, va_list) PRINTF_FORMAT(2, 0);
+
+int fgetc(FILE*);
+char* fgets(char*, int size, FILE*);
+size_t fread(void*, size_t size, size_t cnt, FILE*);
+int getchar(void);
+
+#define putc(C, FP) fputc(C, FP)
+#define getc(FP) fgetc(FP)
+
 #endif /* lib/user/stdio.h */
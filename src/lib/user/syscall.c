@@ -2,16 +2,41 @@
 
 #include <syscall.h>
 #include <stdio.h>
+#include <cpu.h>
+
+/* Whether to enter the kernel with SYSENTER rather than
+	`int $0x30': -1 until probed, then 0 or 1. */
+static int use_sysenter = -1;
+
+/* Probes for SYSENTER support once. */
+static void probe_sysenter(void)
+{
+	if (use_sysenter < 0)
+		use_sysenter = cpu_has_sysenter();
+}
+
+/* Instructions that enter the kernel once the system call number
+	and arguments have been pushed.  When SYSENTER is available we
+	hand the kernel our stack pointer in %ecx and the address to
+	resume at in %edx, and SYSEXIT returns us to label 2;
+	otherwise we fall back to `int $0x30'.  Either way the kernel
+	sees the same stack layout. */
+#define SYSCALL_ENTER                                         \
+	"cmpl $0, %[fast]; je 1f; "                                \
+	"movl %%esp, %%ecx; movl $2f, %%edx; sysenter; "           \
+	"1: int $0x30; 2: "
 
 /* Invokes syscall NUMBER, passing no arguments, and returns the
 	return value as an `int'. */
 #define syscall0(NUMBER)                                        \
 	({                                                           \
 		int retval;                                               \
-		asm volatile("pushl %[number]; int $0x30; addl $4, %%esp" \
+		probe_sysenter();                                         \
+		asm volatile("pushl %[number]; " SYSCALL_ENTER            \
+						 "addl $4, %%esp"                             \
 						 : "=a"(retval)                               \
-						 : [number] "i"(NUMBER)                       \
-						 : "memory");                                 \
+						 : [number] "i"(NUMBER), [fast] "m"(use_sysenter) \
+						 : "ecx", "edx", "cc", "memory");             \
 		retval;                                                   \
 	})
 
@@ -20,10 +45,13 @@
 #define syscall1(NUMBER, ARG0)                                                 \
 	({                                                                          \
 		int retval;                                                              \
-		asm volatile("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
+		probe_sysenter();                                                        \
+		asm volatile("pushl %[arg0]; pushl %[number]; " SYSCALL_ENTER            \
+						 "addl $8, %%esp"                                            \
 						 : "=a"(retval)                                              \
-						 : [number] "i"(NUMBER), [arg0] "g"(ARG0)                    \
-						 : "memory");                                                \
+						 : [number] "i"(NUMBER), [arg0] "g"(ARG0),                   \
+							[fast] "m"(use_sysenter)                                 \
+						 : "ecx", "edx", "cc", "memory");                            \
 		retval;                                                                  \
 	})
 
@@ -32,12 +60,14 @@
 #define syscall2(NUMBER, ARG0, ARG1)                                 \
 	({                                                                \
 		int retval;                                                    \
+		probe_sysenter();                                              \
 		asm volatile(                                                  \
 			 "pushl %[arg1]; pushl %[arg0]; "                           \
-			 "pushl %[number]; int $0x30; addl $12, %%esp"              \
+			 "pushl %[number]; " SYSCALL_ENTER "addl $12, %%esp"        \
 			 : "=a"(retval)                                             \
-			 : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1) \
-			 : "memory");                                               \
+			 : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1), \
+				[fast] "m"(use_sysenter)                                  \
+			 : "ecx", "edx", "cc", "memory");                           \
 		retval;                                                        \
 	})
 
@@ -46,19 +76,36 @@
 #define syscall3(NUMBER, ARG0, ARG1, ARG2)                                             \
 	({                                                                                  \
 		int retval;                                                                      \
+		probe_sysenter();                                                                \
 		asm volatile(                                                                    \
 			 "pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "                              \
-			 "pushl %[number]; int $0x30; addl $16, %%esp"                                \
+			 "pushl %[number]; " SYSCALL_ENTER "addl $16, %%esp"                          \
+			 : "=a"(retval)                                                               \
+			 : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1), [arg2] "r"(ARG2), \
+				[fast] "m"(use_sysenter)                                                    \
+			 : "ecx", "edx", "cc", "memory");                                             \
+		retval;                                                                          \
+	})
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+	and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                                       \
+	({                                                                                  \
+		int retval;                                                                      \
+		probe_sysenter();                                                                \
+		asm volatile(                                                                    \
+			 "pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "               \
+			 "pushl %[number]; " SYSCALL_ENTER "addl $20, %%esp"                          \
 			 : "=a"(retval)                                                               \
-			 : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1), [arg2] "r"(ARG2) \
-			 : "memory");                                                                 \
+			 : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1), [arg2] "r"(ARG2), \
+				[arg3] "g"(ARG3), [fast] "m"(use_sysenter)                                  \
+			 : "ecx", "edx", "cc", "memory");                                             \
 		retval;                                                                          \
 	})
 
 void sleep(int millis) {
 
 	syscall1(SYS_SLEEP, millis);
-	NOT_REACHED();
 
 }
 
@@ -68,8 +115,11 @@ void halt(void)
 	NOT_REACHED();
 }
 
+/* Flushes every stdio stream, then ends the process.  main()
+	returning in _start() comes here too. */
 void exit(int status)
 {
+	fflush(NULL);
 	syscall1(SYS_EXIT, status);
 	NOT_REACHED();
 }
@@ -163,3 +213,53 @@ int inumber(int fd)
 {
 	return syscall1(SYS_INUMBER, fd);
 }
+
+pid_t getpid(void)
+{
+	return syscall0(SYS_GETPID);
+}
+
+int pread(int fd, void* buffer, unsigned size, unsigned offset)
+{
+	return syscall4(SYS_PREAD, fd, buffer, size, offset);
+}
+
+int pwrite(int fd, const void* buffer, unsigned size, unsigned offset)
+{
+	return syscall4(SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int readv(int fd, const struct iovec* iov, int iovcnt)
+{
+	return syscall3(SYS_READV, fd, iov, iovcnt);
+}
+
+int writev(int fd, const struct iovec* iov, int iovcnt)
+{
+	return syscall3(SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int ioring_setup(unsigned entries, void* addr)
+{
+	return syscall2(SYS_IORING_SETUP, entries, addr);
+}
+
+int ioring_enter(unsigned to_submit, unsigned min_complete)
+{
+	return syscall2(SYS_IORING_ENTER, to_submit, min_complete);
+}
+
+int copy_file_range(int fd_in, int fd_out, unsigned length)
+{
+	return syscall3(SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
+
+int pipe(int fds[2])
+{
+	return syscall1(SYS_PIPE, fds);
+}
+
+void* sbrk(int increment)
+{
+	return (void*) syscall1(SYS_SBRK, increment);
+}
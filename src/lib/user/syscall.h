@@ -15,12 +15,21 @@ typedef int mapid_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* One buffer of a vectored read or write. */
+struct iovec {
+	void* iov_base; /* Start of buffer. */
+	unsigned iov_len; /* Size of buffer in bytes. */
+};
+
+/* Maximum number of buffers in one readv() or writev(). */
+#define IOV_MAX 64
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0 /* Successful execution. */
 #define EXIT_FAILURE 1 /* Unsuccessful execution. */
 
 /* Projects 2 and later. */
-void sleep(int millis) NO_RETURN;
+void sleep(int millis);
 void halt(void) NO_RETURN;
 void exit(int status) NO_RETURN;
 pid_t exec(const char* file);
@@ -46,4 +55,16 @@ bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
 
+/* Extensions. */
+pid_t getpid(void);
+int pread(int fd, void* buffer, unsigned length, unsigned offset);
+int pwrite(int fd, const void* buffer, unsigned length, unsigned offset);
+int readv(int fd, const struct iovec* iov, int iovcnt);
+int writev(int fd, const struct iovec* iov, int iovcnt);
+int ioring_setup(unsigned entries, void* addr);
+int ioring_enter(unsigned to_submit, unsigned min_complete);
+int copy_file_range(int fd_in, int fd_out, unsigned length);
+int pipe(int fds[2]);
+void* sbrk(int increment);
+
 #endif /* lib/user/syscall.h */
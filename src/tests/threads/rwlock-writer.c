@@ -0,0 +1,102 @@
+/* Starts several reader threads that keep a reader-writer lock
+	continuously read-held, with overlapping hold times, and then
+	tries to acquire the lock for writing.  With a readers'
+	preference lock the writer would starve; here it must get in
+	once the readers that held the lock when it arrived are gone.
+	Also exercises upgrading and downgrading. */
+
+#include "devices/timer.h"
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#include <stdio.h>
+
+#define READER_CNT 4		 /* Number of reader threads. */
+#define HOLD_TICKS 3		 /* Ticks each reader holds the lock. */
+#define MAX_WAIT_TICKS 50 /* Bound on the writer's wait. */
+
+/* Information about the test. */
+struct rwlock_test {
+	struct rwlock rw;				  /* Lock under test. */
+	int active_readers;			  /* Readers inside the lock. */
+	bool stop;						  /* Tells readers to finish. */
+	struct semaphore done;		  /* Up'd by each reader when it finishes. */
+	bool overlap;					  /* Set if a reader saw the writer inside. */
+	struct thread* volatile writer; /* Writer inside the lock, if any. */
+};
+
+static void reader(void*);
+
+void test_rwlock_writer(void)
+{
+	struct rwlock_test test;
+	int64_t start, waited;
+	int i;
+
+	rwlock_init(&test.rw);
+	test.active_readers = 0;
+	test.stop = false;
+	test.overlap = false;
+	test.writer = NULL;
+	sema_init(&test.done, 0);
+
+	for (i = 0; i < READER_CNT; i++) {
+		char name[16];
+		snprintf(name, sizeof name, "reader %d", i);
+		thread_create(name, PRI_DEFAULT, reader, &test);
+	}
+
+	/* Let the readers get going. */
+	timer_sleep(20);
+
+	start = timer_ticks();
+	rwlock_acquire_write(&test.rw);
+	waited = timer_elapsed(start);
+	test.writer = thread_current();
+	if (test.active_readers != 0)
+		fail("writer got in with %d readers inside", test.active_readers);
+	timer_sleep(HOLD_TICKS);
+	test.writer = NULL;
+	rwlock_release_write(&test.rw);
+
+	if (waited > MAX_WAIT_TICKS)
+		fail("writer waited %lld ticks behind readers", waited);
+	msg("Writer got the lock while readers kept reading.");
+
+	test.stop = true;
+	for (i = 0; i < READER_CNT; i++) sema_down(&test.done);
+	if (test.overlap)
+		fail("reader ran while the writer held the lock");
+
+	/* Upgrade and downgrade. */
+	rwlock_acquire_read(&test.rw);
+	if (!rwlock_upgrade(&test.rw) || !rwlock_held_for_write(&test.rw))
+		fail("upgrade failed");
+	rwlock_downgrade(&test.rw);
+	if (rwlock_held_for_write(&test.rw))
+		fail("still write-held after downgrade");
+	rwlock_release_read(&test.rw);
+	msg("Upgrade and downgrade work.");
+
+	pass();
+}
+
+/* Reader thread.  Takes and releases the lock for reading until
+	told to stop, staggered so that the hold times overlap. */
+static void reader(void* test_)
+{
+	struct rwlock_test* test = test_;
+
+	while (!test->stop) {
+		rwlock_acquire_read(&test->rw);
+		test->active_readers++;
+		if (test->writer != NULL)
+			test->overlap = true;
+		timer_sleep(HOLD_TICKS);
+		test->active_readers--;
+		rwlock_release_read(&test->rw);
+		timer_sleep(1);
+	}
+	sema_up(&test->done);
+}
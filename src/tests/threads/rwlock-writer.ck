@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) Writer got the lock while readers kept reading.
+(rwlock-writer) Upgrade and downgrade work.
+(rwlock-writer) PASS
+(rwlock-writer) end
+EOF
+pass;
@@ -16,6 +16,8 @@ static const struct test tests[] = {
 	 //	 {"alarm-priority", test_alarm_priority},
 	 {"alarm-zero", test_alarm_zero},
 	 {"alarm-negative", test_alarm_negative},
+	 {"rwlock-writer", test_rwlock_writer},
+	 {"workqueue", test_workqueue},
 	 //	 {"priority-change", test_priority_change},
 	 //	 {"priority-donate-one", test_priority_donate_one},
 	 //	 {"priority-donate-multiple", test_priority_donate_multiple},
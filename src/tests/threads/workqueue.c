@@ -0,0 +1,93 @@
+/* Runs work on a single-worker work queue.  While the worker is
+	held up, low, normal and high priority work is queued; it must
+	then run in priority order.  Also checks that delayed work does
+	not run early and that work_wait() and work_cancel() work. */
+
+#include "devices/timer.h"
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/workqueue.h"
+
+#include <stdio.h>
+
+/* Information about the test. */
+struct wq_test {
+	struct semaphore held; /* Up'd once the worker is held up. */
+	struct semaphore gate; /* Holds up the worker. */
+	char order[8];			  /* Letters of work run so far. */
+	int order_cnt;			  /* Number of letters in ORDER. */
+	int64_t ran_at;		  /* When the delayed work ran. */
+};
+
+static struct wq_test test;
+
+static void hold_worker(void*);
+static void record(void*);
+static void record_time(void*);
+
+void test_workqueue(void)
+{
+	struct workqueue* wq;
+	struct work hold, low, normal, high, delayed, cancelled;
+	int64_t start;
+
+	sema_init(&test.held, 0);
+	sema_init(&test.gate, 0);
+	test.order_cnt = 0;
+
+	wq = workqueue_create("test", 1);
+	if (wq == NULL)
+		fail("workqueue_create failed");
+
+	work_init(&hold, hold_worker, NULL, WORK_PRI_NORMAL);
+	work_init(&low, record, "L", WORK_PRI_LOW);
+	work_init(&normal, record, "N", WORK_PRI_NORMAL);
+	work_init(&high, record, "H", WORK_PRI_HIGH);
+	work_init(&cancelled, record, "C", WORK_PRI_HIGH);
+
+	work_queue(wq, &hold);
+	sema_down(&test.held);
+	work_queue(wq, &low);
+	work_queue(wq, &normal);
+	work_queue(wq, &high);
+	work_queue(wq, &cancelled);
+	if (work_queue(wq, &high))
+		fail("pending work was queued twice");
+	if (!work_cancel(&cancelled))
+		fail("could not cancel pending work");
+	sema_up(&test.gate);
+	workqueue_flush(wq);
+
+	test.order[test.order_cnt] = '\0';
+	msg("Work ran in order %s.", test.order);
+
+	start = timer_ticks();
+	work_init(&delayed, record_time, NULL, WORK_PRI_NORMAL);
+	work_queue_delayed(wq, &delayed, 10);
+	work_wait(&delayed);
+	if (test.ran_at - start < 10)
+		fail("delayed work ran after %lld ticks", test.ran_at - start);
+	msg("Delayed work ran on time.");
+
+	pass();
+}
+
+/* Blocks the worker until the test lets it go. */
+static void hold_worker(void* aux UNUSED)
+{
+	sema_up(&test.held);
+	sema_down(&test.gate);
+}
+
+/* Records the letter AUX. */
+static void record(void* letter_)
+{
+	const char* letter = letter_;
+	test.order[test.order_cnt++] = *letter;
+}
+
+/* Records the current time. */
+static void record_time(void* aux UNUSED)
+{
+	test.ran_at = timer_ticks();
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Work ran in order HNL.
+(workqueue) Delayed work ran on time.
+(workqueue) PASS
+(workqueue) end
+EOF
+pass;
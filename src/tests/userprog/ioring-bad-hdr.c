@@ -0,0 +1,39 @@
+/* Scribbles over the layout fields of an I/O ring's header, so
+	that they point the queues outside the ring, then submits
+	through the ring.  The kernel must keep using the layout it set
+	up, posting the completion in the real queue, and must refuse
+	a submission tail that runs far ahead of the head. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#include <ioring.h>
+#include <string.h>
+#include <syscall.h>
+
+#define RING_ADDR ((void*) 0x20000000)
+
+void test_main(void)
+{
+	struct ioring_hdr* h = RING_ADDR;
+	struct ioring_sqe* sqes;
+	struct ioring_cqe* cqes;
+
+	CHECK(ioring_setup(4, RING_ADDR) == 0, "ioring_setup");
+	sqes = ioring_sqes(h);
+	cqes = ioring_cqes(h);
+
+	h->sqes_off = h->cqes_off = 0x3ff00000;
+	h->sq_entries = h->cq_entries = 0x80000000;
+
+	memset(&sqes[0], 0, sizeof sqes[0]);
+	sqes[0].opcode = IORING_OP_NOP;
+	sqes[0].user_data = 42;
+	h->sq_tail++;
+	CHECK(ioring_enter(1, 1) == 1, "submit through the corrupted header");
+	CHECK(h->cq_tail == 1 && cqes[0].user_data == 42 && cqes[0].res == 0,
+			"completion posted in the real queue");
+
+	h->sq_tail = h->sq_head + 1000;
+	CHECK(ioring_enter(1000, 0) == -1, "reject a runaway submission tail");
+}
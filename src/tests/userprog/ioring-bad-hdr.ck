@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ioring-bad-hdr) begin
+(ioring-bad-hdr) ioring_setup
+(ioring-bad-hdr) submit through the corrupted header
+(ioring-bad-hdr) completion posted in the real queue
+(ioring-bad-hdr) reject a runaway submission tail
+(ioring-bad-hdr) end
+ioring-bad-hdr: exit(0)
+EOF
+pass;
@@ -13,9 +13,11 @@
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 
 #include <console.h>
+#include <cpu.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <limits.h>
@@ -26,6 +28,7 @@
 #include <string.h>
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/fdtable.h"
 #include "userprog/gdt.h"
 #include "userprog/process.h"
 #include "userprog/slowdown.h"
@@ -40,6 +43,9 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t* init_page_dir;
@@ -72,6 +78,8 @@ static size_t user_page_limit = SIZE_MAX;
 
 static void bss_init(void);
 static void paging_init(void);
+static uint32_t read_cr4(void);
+static void write_cr4(uint32_t);
 
 static char** read_command_line(void);
 static char** parse_options(char** argv);
@@ -141,6 +149,10 @@ int main(void)
 	locate_block_devices();
 	filesys_init(format_filesys);
 #endif
+#ifdef VM
+	/* Initialize virtual memory. */
+	page_init();
+#endif
 
 	printf("Boot complete.\n");
 
@@ -164,15 +176,28 @@ static void bss_init(void)
 	memset(&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
-/* Populates the base page directory and page table with the
+/* CR4 bits.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR4_PSE 0x00000010 /* Page Size Extensions (4 MB pages). */
+#define CR4_PGE 0x00000080 /* Page Global Enable. */
+
+/* Populates the base page directory and page tables with the
 	kernel virtual mapping, and then sets up the CPU to use the
 	new page directory.  Points init_page_dir to the page
-	directory it creates. */
+	directory it creates.
+
+	If the CPU supports them, every 4 MB stretch of RAM that holds
+	no kernel code is mapped with a single large page, and all
+	kernel mappings are marked global, so that they survive the
+	CR3 reload on each process switch.  Kernel code stays in 4 kB
+	pages so that it can remain read-only. */
 static void paging_init(void)
 {
 	uint32_t *pd, *pt;
 	size_t page;
 	extern char _start, _end_kernel_text;
+	bool large = cpu_has_features(CPUID_1_EDX_PSE);
+	uint32_t global = cpu_has_features(CPUID_1_EDX_PGE) ? PTE_G : 0;
+	size_t large_pages = PTSPAN / PGSIZE;
 
 	pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO);
 	pt = NULL;
@@ -183,20 +208,52 @@ static void paging_init(void)
 		size_t pte_idx = pt_no(vaddr);
 		bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+		if (large && pte_idx == 0 && page + large_pages <= init_ram_pages
+			 && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text)) {
+			pd[pde_idx] = pde_create_kernel_large(vaddr) | global;
+			page += large_pages - 1;
+			continue;
+		}
+
 		if (pd[pde_idx] == 0) {
 			pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
 			pd[pde_idx] = pde_create(pt);
 		}
 
-		pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text);
+		pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text) | global;
 	}
 
+	/* The CPU must understand large pages before it walks a
+		page directory that uses them. */
+	if (large)
+		write_cr4(read_cr4() | CR4_PSE);
+
 	/* Store the physical address of the page directory into CR3
 		aka PDBR (page directory base register).  This activates our
 		new page tables immediately.  See [IA32-v2a] "MOV--Move
 		to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
 		of the Page Directory". */
 	asm volatile("movl %0, %%cr3" : : "r"(vtop(init_page_dir)));
+
+	/* Turning on global pages only now also flushes whatever the
+		loader's page tables left in the TLB.  See [IA32-v3a] 3.12
+		"Translation Lookaside Buffers (TLBs)". */
+	if (global)
+		write_cr4(read_cr4() | CR4_PGE);
+}
+
+/* Returns the contents of control register CR4. */
+static uint32_t read_cr4(void)
+{
+	uint32_t cr4;
+	asm volatile("movl %%cr4, %0" : "=r"(cr4));
+	return cr4;
+}
+
+/* Loads CR4 into control register CR4. */
+static void write_cr4(uint32_t cr4)
+{
+	asm volatile("movl %0, %%cr4" : : "r"(cr4) : "memory");
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -268,6 +325,8 @@ static char** parse_options(char** argv)
 			random_init(atoi(value));
 		else if (!strcmp(name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp(name, "-lockstat"))
+			lockstat_enabled = true;
 #ifdef USERPROG
 		else if (!strcmp(name, "-ul"))
 			user_page_limit = atoi(value);
@@ -275,6 +334,10 @@ static char** parse_options(char** argv)
 			free_page_limit = atoi(value);
 		else if (!strcmp(name, "-tcl"))
 			thread_create_limit = atoi(value);
+		else if (!strcmp(name, "-fdlimit"))
+			fd_limit = atoi(value);
+		else if (!strcmp(name, "-syscallstat"))
+			syscall_stats_enabled = true;
 #endif
 		else
 			PANIC("unknown option `%s' (use -h for help)", name);
@@ -394,11 +457,14 @@ static void usage(void)
 #endif
 		 "  -rs=SEED           Set random number seed to SEED.\n"
 		 "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+		 "  -lockstat          Collect lock contention statistics.\n"
 		 "  -F=FREQ            Set the system timer to FREQ frequency.\n"
 		 "  -tcl=COUNT         Limit the number of threads to COUNT.\n"
 		 "  -fl=COUNT          Limit system memory to COUNT pages.\n"
 #ifdef USERPROG
 		 "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+		 "  -fdlimit=COUNT     Let each process open at most COUNT files.\n"
+		 "  -syscallstat       Report per-system-call counts and cycles.\n"
 #endif
 	);
 	shutdown_power_off();
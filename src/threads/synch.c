@@ -28,12 +28,49 @@
 
 #include "threads/synch.h"
 
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
 #include <stdio.h>
 #include <string.h>
 
+/* Contention statistics, shared by every lock or semaphore that
+	was initialized with the same name.  Locks initialized without
+	a name are keyed by the call site of lock_init() instead, so
+	e.g. all inodes' locks end up in a single entry.  Semaphores
+	are only tracked when named, because most of them are used
+	for signaling rather than mutual exclusion and their "wait"
+	is not contention.
+
+	Statistics are only collected when lockstat_enabled is set,
+	otherwise the stat pointer of every semaphore stays null and
+	the only cost is a null check. */
+struct lockstat {
+	const char* name;			/* Name given at init time, or NULL. */
+	void* site;					/* Caller of lock_init() if unnamed. */
+	uint64_t acquire_cnt;	/* Successful acquisitions. */
+	uint64_t contended_cnt; /* Acquisitions that found it taken. */
+	int64_t wait_ticks;		/* Total ticks spent waiting. */
+	int64_t max_wait_ticks; /* Longest single wait. */
+	int64_t max_hold_ticks; /* Longest single hold (locks only). */
+};
+
+/* Statistics table.  Static, because locks are initialized
+	before malloc() works (and malloc() has locks of its own). */
+#define LOCKSTAT_MAX 128
+static struct lockstat lockstats[LOCKSTAT_MAX];
+static size_t lockstat_cnt;
+
+/* If true, locks and semaphores collect contention statistics.
+	Controlled by kernel command-line option "-lockstat". */
+bool lockstat_enabled;
+
+static struct lockstat* lockstat_lookup(const char* name, void* site);
+static void lockstat_acquired(struct lockstat*, bool contended, int64_t start);
+static void sema_init_stat(struct semaphore*, unsigned value, struct lockstat*);
+static void lock_init_stat(struct lock*, struct lockstat*);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
 	nonnegative integer along with two atomic operators for
 	manipulating it:
@@ -44,11 +81,29 @@
 	- up or "V": increment the value (and wake up one waiting
 	  thread, if any). */
 void sema_init(struct semaphore* sema, unsigned value)
+{
+	sema_init_stat(sema, value, NULL);
+}
+
+/* Initializes semaphore SEMA to VALUE, like sema_init(), and
+	accounts waits on it under NAME when lock statistics are
+	enabled. */
+void sema_init_named(struct semaphore* sema, unsigned value, const char* name)
+{
+	ASSERT(name != NULL);
+
+	sema_init_stat(sema, value, lockstat_enabled ? lockstat_lookup(name, NULL) : NULL);
+}
+
+/* Initializes SEMA to VALUE with statistics entry STAT, which
+	may be null. */
+static void sema_init_stat(struct semaphore* sema, unsigned value, struct lockstat* stat)
 {
 	ASSERT(sema != NULL);
 
 	sema->value = value;
 	list_init(&sema->waiters);
+	sema->stat = stat;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -61,16 +116,23 @@ void sema_init(struct semaphore* sema, unsigned value)
 void sema_down(struct semaphore* sema)
 {
 	enum intr_level old_level;
+	bool contended;
+	int64_t start = 0;
 
 	ASSERT(sema != NULL);
 	ASSERT(!intr_context());
 
 	old_level = intr_disable();
+	contended = sema->value == 0;
+	if (contended && sema->stat != NULL)
+		start = timer_ticks();
 	while (sema->value == 0) {
 		list_push_back(&sema->waiters, &thread_current()->elem);
 		thread_block();
 	}
 	sema->value--;
+	if (sema->stat != NULL)
+		lockstat_acquired(sema->stat, contended, start);
 	intr_set_level(old_level);
 }
 
@@ -93,6 +155,12 @@ bool sema_try_down(struct semaphore* sema)
 	}
 	else
 		success = false;
+	if (sema->stat != NULL) {
+		if (success)
+			sema->stat->acquire_cnt++;
+		else
+			sema->stat->contended_cnt++;
+	}
 	intr_set_level(old_level);
 
 	return success;
@@ -164,11 +232,29 @@ static void sema_test_helper(void* sema_)
 	onerous, it's a good sign that a semaphore should be used,
 	instead of a lock. */
 void lock_init(struct lock* lock)
+{
+	lock_init_stat(
+		 lock, lockstat_enabled ? lockstat_lookup(NULL, __builtin_return_address(0)) : NULL);
+}
+
+/* Initializes LOCK, like lock_init(), and accounts its
+	acquisitions under NAME when lock statistics are enabled. */
+void lock_init_named(struct lock* lock, const char* name)
+{
+	ASSERT(name != NULL);
+
+	lock_init_stat(lock, lockstat_enabled ? lockstat_lookup(name, NULL) : NULL);
+}
+
+/* Initializes LOCK with statistics entry STAT, which may be
+	null. */
+static void lock_init_stat(struct lock* lock, struct lockstat* stat)
 {
 	ASSERT(lock != NULL);
 
 	lock->holder = NULL;
-	sema_init(&lock->semaphore, 1);
+	lock->acquire_ticks = 0;
+	sema_init_stat(&lock->semaphore, 1, stat);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -187,6 +273,8 @@ void lock_acquire(struct lock* lock)
 
 	sema_down(&lock->semaphore);
 	lock->holder = thread_current();
+	if (lock->semaphore.stat != NULL)
+		lock->acquire_ticks = timer_ticks();
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -203,8 +291,11 @@ bool lock_try_acquire(struct lock* lock)
 	ASSERT(!lock_held_by_current_thread(lock));
 
 	success = sema_try_down(&lock->semaphore);
-	if (success)
+	if (success) {
 		lock->holder = thread_current();
+		if (lock->semaphore.stat != NULL)
+			lock->acquire_ticks = timer_ticks();
+	}
 	return success;
 }
 
@@ -218,6 +309,15 @@ void lock_release(struct lock* lock)
 	ASSERT(lock != NULL);
 	ASSERT(lock_held_by_current_thread(lock));
 
+	if (lock->semaphore.stat != NULL) {
+		struct lockstat* stat = lock->semaphore.stat;
+		int64_t held = timer_ticks() - lock->acquire_ticks;
+		enum intr_level old_level = intr_disable();
+		if (held > stat->max_hold_ticks)
+			stat->max_hold_ticks = held;
+		intr_set_level(old_level);
+	}
+
 	lock->holder = NULL;
 	sema_up(&lock->semaphore);
 }
@@ -316,3 +416,257 @@ void cond_broadcast(struct condition* cond, struct lock* lock)
 
 	while (!list_empty(&cond->waiters)) cond_signal(cond, lock);
 }
+
+/* Initializes RW.  A reader-writer lock may be held by any
+	number of readers at once, or by a single writer.
+
+	The lock prefers writers: as soon as a writer is waiting, new
+	readers are held back, so a steady stream of readers cannot
+	starve it.  Readers that queued up behind a writer are in turn
+	all admitted together when that writer releases the lock,
+	before the next writer gets in, so writers cannot starve
+	readers either.
+
+	A reader may upgrade to a writer with rwlock_upgrade() and a
+	writer may downgrade to a reader with rwlock_downgrade(). */
+void rwlock_init(struct rwlock* rw)
+{
+	ASSERT(rw != NULL);
+
+	lock_init(&rw->lock);
+	cond_init(&rw->readers_ok);
+	cond_init(&rw->writer_ok);
+	cond_init(&rw->upgrade_ok);
+	rw->readers = 0;
+	rw->waiting_readers = 0;
+	rw->waiting_writers = 0;
+	rw->read_gen = 0;
+	rw->writer = NULL;
+	rw->upgrader = NULL;
+}
+
+/* Admits every reader waiting on RW.  They are counted as
+	holders right away, so that no writer can slip in before they
+	get to run. */
+static void admit_readers(struct rwlock* rw)
+{
+	ASSERT(lock_held_by_current_thread(&rw->lock));
+
+	if (rw->waiting_readers > 0) {
+		rw->readers += rw->waiting_readers;
+		rw->waiting_readers = 0;
+		rw->read_gen++;
+		cond_broadcast(&rw->readers_ok, &rw->lock);
+	}
+}
+
+/* Acquires RW for reading, sleeping while it is held by a writer
+	or while a writer is waiting for it. */
+void rwlock_acquire_read(struct rwlock* rw)
+{
+	ASSERT(rw != NULL);
+	ASSERT(!intr_context());
+
+	lock_acquire(&rw->lock);
+	if (rw->writer != NULL || rw->waiting_writers > 0 || rw->upgrader != NULL) {
+		unsigned gen = rw->read_gen;
+
+		/* admit_readers() counts us in RW->readers. */
+		rw->waiting_readers++;
+		while (gen == rw->read_gen) cond_wait(&rw->readers_ok, &rw->lock);
+	}
+	else
+		rw->readers++;
+	lock_release(&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void rwlock_release_read(struct rwlock* rw)
+{
+	ASSERT(rw != NULL);
+
+	lock_acquire(&rw->lock);
+	ASSERT(rw->readers > 0);
+	rw->readers--;
+	if (rw->upgrader != NULL) {
+		if (rw->readers == 1)
+			cond_signal(&rw->upgrade_ok, &rw->lock);
+	}
+	else if (rw->readers == 0 && rw->waiting_writers > 0)
+		cond_signal(&rw->writer_ok, &rw->lock);
+	lock_release(&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+	it. */
+void rwlock_acquire_write(struct rwlock* rw)
+{
+	ASSERT(rw != NULL);
+	ASSERT(!intr_context());
+	ASSERT(!rwlock_held_for_write(rw));
+
+	lock_acquire(&rw->lock);
+	rw->waiting_writers++;
+	while (rw->writer != NULL || rw->readers > 0 || rw->upgrader != NULL)
+		cond_wait(&rw->writer_ok, &rw->lock);
+	rw->waiting_writers--;
+	rw->writer = thread_current();
+	lock_release(&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing.
+	Readers that were waiting get the lock next, otherwise the
+	next waiting writer does. */
+void rwlock_release_write(struct rwlock* rw)
+{
+	ASSERT(rw != NULL);
+	ASSERT(rwlock_held_for_write(rw));
+
+	lock_acquire(&rw->lock);
+	rw->writer = NULL;
+	if (rw->waiting_readers > 0)
+		admit_readers(rw);
+	else if (rw->waiting_writers > 0)
+		cond_signal(&rw->writer_ok, &rw->lock);
+	lock_release(&rw->lock);
+}
+
+/* Converts the current thread's read hold on RW into a write
+	hold, sleeping until all other readers are gone.  New readers
+	and writers are held back in the meantime.
+
+	Only one reader may be upgrading at a time, since two would
+	wait for each other forever.  Returns false without waiting if
+	another thread is already upgrading; the caller then still
+	holds RW for reading and should release it and call
+	rwlock_acquire_write() instead. */
+bool rwlock_upgrade(struct rwlock* rw)
+{
+	ASSERT(rw != NULL);
+	ASSERT(!intr_context());
+
+	lock_acquire(&rw->lock);
+	ASSERT(rw->readers > 0);
+	if (rw->upgrader != NULL) {
+		lock_release(&rw->lock);
+		return false;
+	}
+
+	rw->upgrader = thread_current();
+	while (rw->readers > 1) cond_wait(&rw->upgrade_ok, &rw->lock);
+	rw->readers = 0;
+	rw->upgrader = NULL;
+	rw->writer = thread_current();
+	lock_release(&rw->lock);
+	return true;
+}
+
+/* Converts the current thread's write hold on RW into a read
+	hold, without letting a writer in between.  Waiting readers are
+	admitted along with us unless a writer is waiting. */
+void rwlock_downgrade(struct rwlock* rw)
+{
+	ASSERT(rw != NULL);
+	ASSERT(rwlock_held_for_write(rw));
+
+	lock_acquire(&rw->lock);
+	rw->writer = NULL;
+	rw->readers++;
+	if (rw->waiting_writers == 0)
+		admit_readers(rw);
+	lock_release(&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing,
+	false otherwise. */
+bool rwlock_held_for_write(const struct rwlock* rw)
+{
+	ASSERT(rw != NULL);
+
+	return rw->writer == thread_current();
+}
+
+/* Returns the statistics entry for NAME, or for call site SITE
+	if NAME is null, creating it if necessary.  Returns a null
+	pointer if the table is full, in which case the lock simply
+	goes unaccounted. */
+static struct lockstat* lockstat_lookup(const char* name, void* site)
+{
+	struct lockstat* stat = NULL;
+	enum intr_level old_level;
+	size_t i;
+
+	old_level = intr_disable();
+	for (i = 0; i < lockstat_cnt; i++) {
+		struct lockstat* s = &lockstats[i];
+		if (name != NULL ? s->name != NULL && !strcmp(s->name, name)
+							  : s->name == NULL && s->site == site) {
+			stat = s;
+			break;
+		}
+	}
+	if (stat == NULL && lockstat_cnt < LOCKSTAT_MAX) {
+		stat = &lockstats[lockstat_cnt++];
+		stat->name = name;
+		stat->site = site;
+	}
+	intr_set_level(old_level);
+
+	return stat;
+}
+
+/* Records an acquisition in STAT.  If CONTENDED, the caller had
+	to wait since tick START.  Must be called with interrupts
+	off. */
+static void lockstat_acquired(struct lockstat* stat, bool contended, int64_t start)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	stat->acquire_cnt++;
+	if (contended) {
+		int64_t waited = timer_ticks() - start;
+		stat->contended_cnt++;
+		stat->wait_ticks += waited;
+		if (waited > stat->max_wait_ticks)
+			stat->max_wait_ticks = waited;
+	}
+}
+
+/* Prints lock statistics, most waited-for locks first.  Does
+	nothing unless lock statistics are enabled. */
+void lockstat_print_stats(void)
+{
+	static struct lockstat* sorted[LOCKSTAT_MAX];
+	size_t cnt = 0;
+	size_t i, j;
+
+	if (!lockstat_enabled)
+		return;
+
+	/* Insertion sort by descending total wait. */
+	for (i = 0; i < lockstat_cnt; i++) {
+		struct lockstat* stat = &lockstats[i];
+		if (stat->acquire_cnt == 0 && stat->contended_cnt == 0)
+			continue;
+		for (j = cnt; j > 0 && sorted[j - 1]->wait_ticks < stat->wait_ticks; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = stat;
+		cnt++;
+	}
+
+	printf("Lockstat: %zu locks, sorted by total wait\n", cnt);
+	for (i = 0; i < cnt; i++) {
+		struct lockstat* stat = sorted[i];
+		if (stat->name != NULL)
+			printf("  %-18s", stat->name);
+		else
+			printf("  lock@%-13p", stat->site);
+		printf(
+			 " %llu acq, %llu contended, %lld wait ticks (max %lld), max hold %lld\n",
+			 stat->acquire_cnt,
+			 stat->contended_cnt,
+			 stat->wait_ticks,
+			 stat->max_wait_ticks,
+			 stat->max_hold_ticks);
+	}
+}
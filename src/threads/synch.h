@@ -3,14 +3,23 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct lockstat;
+
+/* If true, locks and semaphores collect contention statistics.
+	Controlled by kernel command-line option "-lockstat". */
+extern bool lockstat_enabled;
 
 /* A counting semaphore. */
 struct semaphore {
-	unsigned value;		/* Current value. */
-	struct list waiters; /* List of waiting threads. */
+	unsigned value;		 /* Current value. */
+	struct list waiters;  /* List of waiting threads. */
+	struct lockstat* stat; /* Contention statistics, or NULL. */
 };
 
 void sema_init(struct semaphore*, unsigned value);
+void sema_init_named(struct semaphore*, unsigned value, const char* name);
 void sema_down(struct semaphore*);
 bool sema_try_down(struct semaphore*);
 void sema_up(struct semaphore*);
@@ -20,13 +29,16 @@ void sema_self_test(void);
 struct lock {
 	struct thread* holder;		 /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	int64_t acquire_ticks;		 /* When holder acquired it (for lockstat). */
 };
 
 void lock_init(struct lock*);
+void lock_init_named(struct lock*, const char* name);
 void lock_acquire(struct lock*);
 bool lock_try_acquire(struct lock*);
 void lock_release(struct lock*);
 bool lock_held_by_current_thread(const struct lock*);
+void lockstat_print_stats(void);
 
 /* Condition variable. */
 struct condition {
@@ -38,6 +50,29 @@ void cond_wait(struct condition*, struct lock*);
 void cond_signal(struct condition*, struct lock*);
 void cond_broadcast(struct condition*, struct lock*);
 
+/* Reader-writer lock. */
+struct rwlock {
+	struct lock lock;				 /* Protects the members below. */
+	struct condition readers_ok; /* Signaled when readers are admitted. */
+	struct condition writer_ok;  /* Signaled when a writer may enter. */
+	struct condition upgrade_ok; /* Signaled when the upgrader may enter. */
+	int readers;					 /* Readers holding the lock. */
+	int waiting_readers;			 /* Readers waiting for admission. */
+	int waiting_writers;			 /* Writers waiting for the lock. */
+	unsigned read_gen;			 /* Bumped when waiting readers are admitted. */
+	struct thread* writer;		 /* Thread holding the lock exclusively. */
+	struct thread* upgrader;	 /* Reader waiting to become writer. */
+};
+
+void rwlock_init(struct rwlock*);
+void rwlock_acquire_read(struct rwlock*);
+void rwlock_release_read(struct rwlock*);
+void rwlock_acquire_write(struct rwlock*);
+void rwlock_release_write(struct rwlock*);
+bool rwlock_upgrade(struct rwlock*);
+void rwlock_downgrade(struct rwlock*);
+bool rwlock_held_for_write(const struct rwlock*);
+
 /* Optimization barrier.
 
 	The compiler will not reorder operations across an
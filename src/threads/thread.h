@@ -6,6 +6,9 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#ifdef USERPROG
+#include "userprog/fdtable.h"
+#endif
 
 /* States in a thread's life cycle. */
 enum thread_status {
@@ -24,7 +27,6 @@ typedef int tid_t;
 #define PRI_MIN	  0  /* Lowest priority. */
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX	  63 /* Highest priority. */
-#define MAX_FILES 128 /* Max files to be open */
 
 /* The relation between a parent thread and a child thread */
 struct parent_child {
@@ -108,8 +110,6 @@ struct thread {
 
 
 	/* Our parameters for the thread struct */
-	struct file* OPEN_FILES[MAX_FILES];		// Initialized to NULL pointers
-
 	int64_t wake_up_time; /* Used for timer sleeping */
 	struct list_elem sleeping_elem; /* List element for sleeping */
 
@@ -119,8 +119,18 @@ struct thread {
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint32_t* pagedir; /* Page directory. */
-
-	
+	struct fd_table fds; /* Open files. */
+	struct ioring* ioring; /* Asynchronous I/O ring, if any. */
+	uint8_t* heap_base; /* Start of the heap, just past the executable. */
+	uint8_t* brk; /* Current end of the heap. */
+	int syscall_nr; /* System call being run. */
+	uint32_t* syscall_argv; /* Its arguments, or null; see userprog/syscall.c. */
+#ifdef VM
+	/* Owned by vm/page.c and userprog/process.c. */
+	struct page_table* pages; /* Supplemental page table. */
+	struct file* exec_file; /* Executable, backing not-yet-loaded pages. */
+	void* user_esp; /* User stack pointer at the last system call. */
+#endif
 #endif
 
 	/* Owned by thread.c. */
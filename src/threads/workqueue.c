@@ -0,0 +1,376 @@
+#include "threads/workqueue.h"
+
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Work queues.  A work queue is a fixed pool of kernel threads
+	that run deferred function calls ("work") handed to them, so
+	that a subsystem that needs something done asynchronously
+	does not have to spend a page and a TID on a thread of its
+	own.
+
+	Runnable work sits in one list per priority.  Work may also be
+	submitted with a delay; it then sits on a single global list,
+	ordered by due time, which the timer interrupt drains into the
+	run queues.  Because of that, the run queues and the delayed
+	list are protected by disabling interrupts, as with the sleep
+	queue in devices/timer.c, and workers sleep on a counting
+	semaphore that may be up'd from the interrupt handler.
+
+	A queue's workers are only started when work is first
+	submitted to it, so creating a queue that is never used costs
+	no threads. */
+
+/* A worker thread. */
+struct worker {
+	struct workqueue* wq;	 /* Queue it serves. */
+	struct work* current;	 /* Work being run, or NULL. */
+};
+
+/* A work queue. */
+struct workqueue {
+	char name[12];							  /* Name, for threads and statistics. */
+	struct list_elem elem;				  /* Element in all_queues. */
+	struct list runnable[WORK_PRI_CNT]; /* Runnable work, by priority. */
+	struct semaphore items;				  /* Counts runnable work. */
+	int outstanding;						  /* Runnable plus running work. */
+	bool started;							  /* Have the workers been created? */
+	int worker_cnt;						  /* Number of workers. */
+	struct worker* workers;				  /* Array of WORKER_CNT workers. */
+
+	/* Completion waiting. */
+	struct lock lock;					/* Lock for COMPLETED. */
+	struct condition completed;	/* Signaled whenever work finishes. */
+
+	/* Statistics. */
+	uint64_t run_cnt;				/* Number of work items run. */
+	int64_t latency_ticks;		/* Total ticks from runnable to started. */
+	int64_t max_latency_ticks; /* Longest such wait. */
+	int64_t run_ticks;			/* Total ticks spent running work. */
+};
+
+/* All work queues. */
+static struct list all_queues = LIST_INITIALIZER(all_queues);
+
+/* Delayed work of all queues, soonest due first. */
+static struct list delayed_list = LIST_INITIALIZER(delayed_list);
+
+static void start_workers(struct workqueue*);
+static void make_runnable(struct work*, int64_t now);
+static bool work_busy(struct work*);
+static list_less_func due_less;
+static thread_func worker_loop NO_RETURN;
+
+/* Creates a work queue named NAME served by WORKER_CNT worker
+	threads.  Returns a null pointer if memory allocation
+	fails. */
+struct workqueue* workqueue_create(const char* name, int worker_cnt)
+{
+	struct workqueue* wq;
+	enum intr_level old_level;
+	int i;
+
+	ASSERT(worker_cnt > 0);
+
+	wq = calloc(1, sizeof *wq);
+	if (wq == NULL)
+		return NULL;
+	wq->workers = calloc(worker_cnt, sizeof *wq->workers);
+	if (wq->workers == NULL) {
+		free(wq);
+		return NULL;
+	}
+
+	strlcpy(wq->name, name, sizeof wq->name);
+	for (i = 0; i < WORK_PRI_CNT; i++) list_init(&wq->runnable[i]);
+	sema_init(&wq->items, 0);
+	wq->worker_cnt = worker_cnt;
+	for (i = 0; i < worker_cnt; i++) wq->workers[i].wq = wq;
+	lock_init(&wq->lock);
+	cond_init(&wq->completed);
+
+	old_level = intr_disable();
+	list_push_back(&all_queues, &wq->elem);
+	intr_set_level(old_level);
+
+	return wq;
+}
+
+/* Starts WQ's worker threads if that has not been done yet. */
+static void start_workers(struct workqueue* wq)
+{
+	enum intr_level old_level;
+	bool started;
+	int i;
+
+	ASSERT(!intr_context());
+
+	old_level = intr_disable();
+	started = wq->started;
+	wq->started = true;
+	intr_set_level(old_level);
+	if (started)
+		return;
+
+	for (i = 0; i < wq->worker_cnt; i++) {
+		char name[16];
+		snprintf(name, sizeof name, "%s/%d", wq->name, i);
+		if (thread_create(name, PRI_DEFAULT, worker_loop, &wq->workers[i]) == TID_ERROR
+			 && i == 0)
+			PANIC("work queue %s: cannot start any worker", wq->name);
+	}
+}
+
+/* Initializes W to call FUNCTION(AUX) at PRIORITY. */
+void work_init(struct work* w, work_func* function, void* aux, enum work_priority priority)
+{
+	ASSERT(w != NULL);
+	ASSERT(function != NULL);
+	ASSERT(priority < WORK_PRI_CNT);
+
+	w->function = function;
+	w->aux = aux;
+	w->priority = priority;
+	w->wq = NULL;
+	w->pending = false;
+	w->delayed = false;
+}
+
+/* Submits W to run on WQ as soon as a worker is free.  Returns
+	false, doing nothing, if W is already pending. */
+bool work_queue(struct workqueue* wq, struct work* w)
+{
+	enum intr_level old_level;
+
+	ASSERT(wq != NULL && w != NULL);
+
+	start_workers(wq);
+
+	old_level = intr_disable();
+	if (w->pending) {
+		intr_set_level(old_level);
+		return false;
+	}
+	w->wq = wq;
+	w->pending = true;
+	make_runnable(w, timer_ticks());
+	intr_set_level(old_level);
+	return true;
+}
+
+/* Submits W to run on WQ once TICKS timer ticks have passed.
+	Returns false, doing nothing, if W is already pending. */
+bool work_queue_delayed(struct workqueue* wq, struct work* w, int64_t ticks)
+{
+	enum intr_level old_level;
+
+	ASSERT(wq != NULL && w != NULL);
+
+	if (ticks <= 0)
+		return work_queue(wq, w);
+
+	start_workers(wq);
+
+	old_level = intr_disable();
+	if (w->pending) {
+		intr_set_level(old_level);
+		return false;
+	}
+	w->wq = wq;
+	w->pending = true;
+	w->delayed = true;
+	w->due = timer_ticks() + ticks;
+	list_insert_ordered(&delayed_list, &w->elem, due_less, NULL);
+	intr_set_level(old_level);
+	return true;
+}
+
+/* Withdraws W if it has not started running yet.  Returns true
+	if it was withdrawn, false if it was not pending. */
+bool work_cancel(struct work* w)
+{
+	struct workqueue* wq = w->wq;
+	enum intr_level old_level;
+	bool cancelled = false;
+
+	if (wq == NULL)
+		return false;
+
+	lock_acquire(&wq->lock);
+	old_level = intr_disable();
+	if (w->pending) {
+		list_remove(&w->elem);
+		if (!w->delayed)
+			wq->outstanding--;
+		w->pending = w->delayed = false;
+		cancelled = true;
+	}
+	intr_set_level(old_level);
+
+	/* The worker that wakes up for W's item finds nothing and goes
+		back to sleep, so WQ->items need not be adjusted. */
+	if (cancelled)
+		cond_broadcast(&wq->completed, &wq->lock);
+	lock_release(&wq->lock);
+
+	return cancelled;
+}
+
+/* Waits until W, if it is pending or running, has finished. */
+void work_wait(struct work* w)
+{
+	struct workqueue* wq = w->wq;
+
+	ASSERT(!intr_context());
+
+	if (wq == NULL)
+		return;
+
+	lock_acquire(&wq->lock);
+	while (work_busy(w)) cond_wait(&wq->completed, &wq->lock);
+	lock_release(&wq->lock);
+}
+
+/* Waits until all runnable and running work on WQ has finished.
+	Delayed work that is not yet due is not waited for. */
+void workqueue_flush(struct workqueue* wq)
+{
+	ASSERT(!intr_context());
+
+	lock_acquire(&wq->lock);
+	while (wq->outstanding > 0) cond_wait(&wq->completed, &wq->lock);
+	lock_release(&wq->lock);
+}
+
+/* Makes delayed work that is due by tick NOW runnable.  Called
+	by the timer interrupt handler on every tick. */
+void workqueue_tick(int64_t now)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (!list_empty(&delayed_list)) {
+		struct work* w = list_entry(list_front(&delayed_list), struct work, elem);
+		if (w->due > now)
+			break;
+		list_pop_front(&delayed_list);
+		w->delayed = false;
+		make_runnable(w, now);
+	}
+}
+
+/* Prints statistics for every work queue that has run work. */
+void workqueue_print_stats(void)
+{
+	struct list_elem* e;
+
+	for (e = list_begin(&all_queues); e != list_end(&all_queues); e = list_next(e)) {
+		struct workqueue* wq = list_entry(e, struct workqueue, elem);
+		if (wq->run_cnt == 0)
+			continue;
+		printf(
+			 "Workqueue %s: %llu items, %lld ticks queued (max %lld), %lld ticks running\n",
+			 wq->name,
+			 wq->run_cnt,
+			 wq->latency_ticks,
+			 wq->max_latency_ticks,
+			 wq->run_ticks);
+	}
+}
+
+/* Puts pending work W on its queue's run queue as of tick NOW
+	and wakes a worker.  Interrupts must be off. */
+static void make_runnable(struct work* w, int64_t now)
+{
+	struct workqueue* wq = w->wq;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	w->queued = now;
+	list_push_back(&wq->runnable[w->priority], &w->elem);
+	wq->outstanding++;
+	sema_up(&wq->items);
+}
+
+/* Returns true if W is pending or being run by one of its
+	queue's workers. */
+static bool work_busy(struct work* w)
+{
+	struct workqueue* wq = w->wq;
+	enum intr_level old_level;
+	bool busy;
+	int i;
+
+	old_level = intr_disable();
+	busy = w->pending;
+	for (i = 0; !busy && i < wq->worker_cnt; i++)
+		if (wq->workers[i].current == w)
+			busy = true;
+	intr_set_level(old_level);
+
+	return busy;
+}
+
+/* Orders work by due time. */
+static bool due_less(const struct list_elem* a, const struct list_elem* b, void* aux UNUSED)
+{
+	return list_entry(a, struct work, elem)->due < list_entry(b, struct work, elem)->due;
+}
+
+/* Worker thread.  Runs the most urgent runnable work of its
+	queue, forever. */
+static void worker_loop(void* worker_)
+{
+	struct worker* worker = worker_;
+	struct workqueue* wq = worker->wq;
+
+	for (;;) {
+		enum intr_level old_level;
+		struct work* w = NULL;
+		int64_t start, latency;
+		int i;
+
+		sema_down(&wq->items);
+
+		/* Take the most urgent work.  Clearing PENDING and setting
+			CURRENT together keeps work_busy() from seeing a gap. */
+		old_level = intr_disable();
+		for (i = 0; i < WORK_PRI_CNT && w == NULL; i++)
+			if (!list_empty(&wq->runnable[i]))
+				w = list_entry(list_pop_front(&wq->runnable[i]), struct work, elem);
+		if (w != NULL) {
+			w->pending = false;
+			worker->current = w;
+		}
+		intr_set_level(old_level);
+
+		/* Cancelled in the meantime. */
+		if (w == NULL)
+			continue;
+
+		start = timer_ticks();
+		latency = start - w->queued;
+		w->function(w->aux);
+
+		/* W may have been freed by its function; only compare
+			pointers from here on. */
+		lock_acquire(&wq->lock);
+		old_level = intr_disable();
+		worker->current = NULL;
+		wq->outstanding--;
+		wq->run_cnt++;
+		wq->latency_ticks += latency;
+		if (latency > wq->max_latency_ticks)
+			wq->max_latency_ticks = latency;
+		wq->run_ticks += timer_ticks() - start;
+		intr_set_level(old_level);
+		cond_broadcast(&wq->completed, &wq->lock);
+		lock_release(&wq->lock);
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Work priorities.  A worker always runs the most urgent
+	runnable work first. */
+enum work_priority {
+	WORK_PRI_HIGH,	  /* Latency-sensitive work. */
+	WORK_PRI_NORMAL, /* Default. */
+	WORK_PRI_LOW,	  /* Background work. */
+	WORK_PRI_CNT	  /* Number of priorities. */
+};
+
+/* Function run by a worker, given auxiliary data AUX. */
+typedef void work_func(void* aux);
+
+/* A deferred call of FUNCTION(AUX), owned by the submitter.
+	The same work may be submitted again once it has started
+	running.  FUNCTION may free the work itself, but then nobody
+	may work_wait() for it. */
+struct work {
+	struct list_elem elem;			/* Run queue or delayed list element. */
+	work_func* function;				/* Function to call. */
+	void* aux;							/* Auxiliary data for FUNCTION. */
+	enum work_priority priority;	/* Run queue to use. */
+	struct workqueue* wq;			/* Queue last submitted to. */
+	bool pending;						/* Submitted but not yet started? */
+	bool delayed;						/* On the delayed list? */
+	int64_t due;						/* Tick at which delayed work becomes runnable. */
+	int64_t queued;					/* Tick at which it became runnable. */
+};
+
+struct workqueue* workqueue_create(const char* name, int worker_cnt);
+void workqueue_flush(struct workqueue*);
+void workqueue_tick(int64_t now);
+void workqueue_print_stats(void);
+
+void work_init(struct work*, work_func*, void* aux, enum work_priority);
+bool work_queue(struct workqueue*, struct work*);
+bool work_queue_delayed(struct workqueue*, struct work*, int64_t ticks);
+bool work_cancel(struct work*);
+void work_wait(struct work*);
+
+#endif /* threads/workqueue.h */
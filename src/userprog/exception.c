@@ -2,8 +2,13 @@
 
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 #include <inttypes.h>
 #include <stdio.h>
@@ -127,6 +132,7 @@ static void page_fault(struct intr_frame* f)
 	bool write;			/* True: access was write, false: access was read. */
 	bool user;			/* True: access by user, false: access by kernel. */
 	void* fault_addr; /* Fault address. */
+	uint32_t fixup;	/* Recovery address for faulting kernel access. */
 
 	/* Obtain faulting address, the virtual address that was
 		accessed to cause the fault.  It may point to code or to
@@ -149,9 +155,25 @@ static void page_fault(struct intr_frame* f)
 	write = (f->error_code & PF_W) != 0;
 	user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+	/* A user page that has not been loaded yet, a new stack page,
+		or the first write to a page that maps the zero frame.  Bring
+		it in and retry the access, whoever made it.  In the kernel,
+		the user's stack pointer is the one saved on entry to the
+		system call. */
+	if ((not_present || write) && is_user_vaddr(fault_addr)
+		 && page_fault_in(fault_addr, user ? f->esp : thread_current()->user_esp, write))
+		return;
+#endif
+
 	if (user) {
 		// User fault. Call exit syscall with status 1
 		exit(-1);
+	} else if ((fixup = uaccess_fixup((uint32_t) f->eip)) != 0) {
+		/* Kernel fault while accessing user memory on behalf of a
+			system call.  Resume at the accessor's recovery code,
+			which reports the bad address to its caller. */
+		f->eip = (void (*)(void)) fixup;
 	} else {
 		/* To implement virtual memory, delete the rest of the function
 			body, and replace it with code that brings in the page to
@@ -0,0 +1,258 @@
+#include "userprog/fdtable.h"
+
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "userprog/pipe.h"
+
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Bits per bitmap word. */
+#define WORD_BITS 32
+
+/* Maximum number of files each process may have open at once.
+	Controlled by the kernel command-line option "-fdlimit". */
+size_t fd_limit = FD_LIMIT_DEFAULT;
+
+/* Number of USED words for CAP slots. */
+static size_t used_words(size_t cap)
+{
+	return cap / WORD_BITS;
+}
+
+/* Number of FULL words for CAP slots. */
+static size_t full_words(size_t cap)
+{
+	return DIV_ROUND_UP(used_words(cap), WORD_BITS);
+}
+
+/* Initializes T as an empty table. */
+void fd_table_init(struct fd_table* t)
+{
+	memset(t, 0, sizeof *t);
+}
+
+/* Closes the file or pipe end in slot E. */
+static void close_entry(struct fd_entry* e)
+{
+	if (e->kind == FD_FILE)
+		file_close(e->obj);
+	else
+		pipe_close(e->obj, e->kind == FD_PIPE_WRITE);
+	e->obj = NULL;
+}
+
+/* Closes every file and pipe still open in T and frees its
+	memory. */
+void fd_table_destroy(struct fd_table* t)
+{
+	size_t w;
+
+	for (w = 0; w < used_words(t->cap); w++) {
+		uint32_t bits = t->used[w];
+		while (bits != 0) {
+			size_t slot = w * WORD_BITS + __builtin_ctz(bits);
+			close_entry(&t->entries[slot]);
+			bits &= bits - 1;
+		}
+	}
+	free(t->entries);
+	free(t->used);
+	free(t->full);
+	fd_table_init(t);
+}
+
+/* Grows T to hold more slots, up to fd_limit.
+	Returns false if it is already as large as allowed or if
+	memory is exhausted. */
+static bool grow(struct fd_table* t)
+{
+	size_t max_cap = ROUND_UP(fd_limit, WORD_BITS);
+	size_t new_cap = t->cap == 0 ? WORD_BITS : t->cap * 2;
+	struct fd_entry* entries;
+	uint32_t *used, *full;
+
+	if (new_cap > max_cap)
+		new_cap = max_cap;
+	if (new_cap <= t->cap)
+		return false;
+
+	entries = realloc(t->entries, new_cap * sizeof *entries);
+	if (entries == NULL)
+		return false;
+	t->entries = entries;
+
+	used = realloc(t->used, used_words(new_cap) * sizeof *used);
+	if (used == NULL)
+		return false;
+	t->used = used;
+
+	full = realloc(t->full, full_words(new_cap) * sizeof *full);
+	if (full == NULL)
+		return false;
+	t->full = full;
+
+	memset(entries + t->cap, 0, (new_cap - t->cap) * sizeof *entries);
+	memset(used + used_words(t->cap), 0,
+			 (used_words(new_cap) - used_words(t->cap)) * sizeof *used);
+	memset(full + full_words(t->cap), 0,
+			 (full_words(new_cap) - full_words(t->cap)) * sizeof *full);
+	t->cap = new_cap;
+	return true;
+}
+
+/* Returns the lowest free slot in T, or SIZE_MAX if all are in
+	use. */
+static size_t lowest_free(const struct fd_table* t)
+{
+	size_t nwords = used_words(t->cap);
+	size_t f;
+
+	for (f = 0; f < full_words(t->cap); f++) {
+		if (t->full[f] != UINT32_MAX) {
+			size_t w = f * WORD_BITS + __builtin_ctz(~t->full[f]);
+			if (w >= nwords)
+				break;
+			return w * WORD_BITS + __builtin_ctz(~t->used[w]);
+		}
+	}
+	return SIZE_MAX;
+}
+
+/* Sets or clears the in-use bit for SLOT in T, keeping FULL in
+	step. */
+static void mark(struct fd_table* t, size_t slot, bool in_use)
+{
+	size_t w = slot / WORD_BITS;
+	uint32_t bit = 1u << (slot % WORD_BITS);
+	uint32_t full_bit = 1u << (w % WORD_BITS);
+
+	if (in_use)
+		t->used[w] |= bit;
+	else
+		t->used[w] &= ~bit;
+
+	if (t->used[w] == UINT32_MAX)
+		t->full[w / WORD_BITS] |= full_bit;
+	else
+		t->full[w / WORD_BITS] &= ~full_bit;
+}
+
+/* Installs OBJ, of the given KIND, in the lowest free slot of T
+	and returns its file descriptor, or -1 if the process already
+	has fd_limit descriptors open or memory is exhausted. */
+int fd_install(struct fd_table* t, enum fd_kind kind, void* obj)
+{
+	size_t slot;
+
+	ASSERT(obj != NULL);
+
+	slot = lowest_free(t);
+	if (slot == SIZE_MAX) {
+		if (!grow(t))
+			return -1;
+		slot = lowest_free(t);
+	}
+	if (slot >= fd_limit)
+		return -1;
+
+	t->entries[slot].obj = obj;
+	t->entries[slot].kind = kind;
+	mark(t, slot, true);
+	t->cnt++;
+	return slot + FD_FIRST;
+}
+
+/* Installs FILE in T as by fd_install(). */
+int fd_alloc(struct fd_table* t, struct file* file)
+{
+	return fd_install(t, FD_FILE, file);
+}
+
+/* Returns the slot for FD in T, or SIZE_MAX if FD is not open. */
+static size_t fd_slot(const struct fd_table* t, int fd)
+{
+	size_t slot;
+
+	if (fd < FD_FIRST)
+		return SIZE_MAX;
+	slot = fd - FD_FIRST;
+	if (slot >= t->cap || !(t->used[slot / WORD_BITS] & (1u << (slot % WORD_BITS))))
+		return SIZE_MAX;
+	return slot;
+}
+
+/* Returns true if FD is open in T. */
+bool fd_is_open(const struct fd_table* t, int fd)
+{
+	return fd_slot(t, fd) != SIZE_MAX;
+}
+
+/* Returns the file open as FD in T, or a null pointer if FD is
+	not open or is not a file. */
+struct file* fd_lookup(const struct fd_table* t, int fd)
+{
+	size_t slot = fd_slot(t, fd);
+	if (slot == SIZE_MAX || t->entries[slot].kind != FD_FILE)
+		return NULL;
+	return t->entries[slot].obj;
+}
+
+/* Returns the pipe open as FD in T, or a null pointer if FD is
+	not open or is not a pipe.  Sets *WRITE_END to whether FD is
+	the pipe's write end. */
+struct pipe* fd_lookup_pipe(const struct fd_table* t, int fd, bool* write_end)
+{
+	size_t slot = fd_slot(t, fd);
+	if (slot == SIZE_MAX || t->entries[slot].kind == FD_FILE)
+		return NULL;
+	*write_end = t->entries[slot].kind == FD_PIPE_WRITE;
+	return t->entries[slot].obj;
+}
+
+/* Closes FD in T and frees its slot.  Returns false if FD was not
+	open. */
+bool fd_close(struct fd_table* t, int fd)
+{
+	size_t slot = fd_slot(t, fd);
+
+	if (slot == SIZE_MAX)
+		return false;
+	close_entry(&t->entries[slot]);
+	mark(t, slot, false);
+	t->cnt--;
+	return true;
+}
+
+/* Gives empty table DST a reference to each pipe open in SRC,
+	under the same descriptor.  Files are not inherited.  Returns
+	false if memory is exhausted, in which case DST may hold only
+	some of the pipes. */
+bool fd_table_inherit(struct fd_table* dst, const struct fd_table* src)
+{
+	size_t w;
+
+	ASSERT(dst->cnt == 0);
+
+	for (w = 0; w < used_words(src->cap); w++) {
+		uint32_t bits = src->used[w];
+		while (bits != 0) {
+			size_t slot = w * WORD_BITS + __builtin_ctz(bits);
+			const struct fd_entry* e = &src->entries[slot];
+
+			bits &= bits - 1;
+			if (e->kind == FD_FILE)
+				continue;
+			while (slot >= dst->cap)
+				if (!grow(dst))
+					return false;
+			pipe_dup(e->obj, e->kind == FD_PIPE_WRITE);
+			dst->entries[slot] = *e;
+			mark(dst, slot, true);
+			dst->cnt++;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,61 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct file;
+struct pipe;
+
+/* Lowest file descriptor handed out by fd_alloc().
+	0 and 1 are the console. */
+#define FD_FIRST 2
+
+/* Default value of fd_limit. */
+#define FD_LIMIT_DEFAULT 1024
+
+/* What a file descriptor refers to. */
+enum fd_kind {
+	FD_FILE,			/* A struct file. */
+	FD_PIPE_READ,	/* Read end of a struct pipe. */
+	FD_PIPE_WRITE	/* Write end of a struct pipe. */
+};
+
+/* One slot in a descriptor table. */
+struct fd_entry {
+	void* obj;			/* Open file or pipe. */
+	enum fd_kind kind;	/* Which one OBJ is. */
+};
+
+/* A process's open files and pipes, indexed by file descriptor.
+
+	The table lives in kernel heap memory, not in the thread's
+	page, and grows by doubling as descriptors are opened, up to
+	fd_limit entries.  A two-level bitmap tracks free slots: USED
+	has one bit per slot, FULL one bit per USED word that has no
+	free slot left.  Finding the lowest free descriptor therefore
+	takes a couple of bit scans instead of a walk over every slot.
+
+	An all-zero struct fd_table is a valid empty table. */
+struct fd_table {
+	struct fd_entry* entries;	/* Slots, indexed by fd - FD_FIRST. */
+	uint32_t* used;				/* Bit set for each slot in use. */
+	uint32_t* full;				/* Bit set for each USED word with no free slot. */
+	size_t cap;						/* Number of slots, a multiple of 32. */
+	size_t cnt;						/* Number of slots in use. */
+};
+
+extern size_t fd_limit;
+
+void fd_table_init(struct fd_table*);
+void fd_table_destroy(struct fd_table*);
+bool fd_table_inherit(struct fd_table* dst, const struct fd_table* src);
+int fd_install(struct fd_table*, enum fd_kind, void* obj);
+int fd_alloc(struct fd_table*, struct file*);
+bool fd_is_open(const struct fd_table*, int fd);
+struct file* fd_lookup(const struct fd_table*, int fd);
+struct pipe* fd_lookup_pipe(const struct fd_table*, int fd, bool* write_end);
+bool fd_close(struct fd_table*, int fd);
+
+#endif /* userprog/fdtable.h */
@@ -0,0 +1,412 @@
+#include "userprog/ioring.h"
+
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "threads/workqueue.h"
+#include "userprog/fdtable.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+#include <debug.h>
+#include <ioring.h>
+#include <round.h>
+#include <string.h>
+
+/* Asynchronous I/O rings (see lib/ioring.h for the protocol).
+
+	ioring_enter() runs in the process and takes entries off the
+	submission queue in order.  Opens and closes change the
+	descriptor table, which only the process itself touches, so
+	they are carried out right there and complete immediately.
+	Reads and writes are handed to the "ioring" work queue, so
+	that many of them can wait on the disk at once; each holds its
+	own reopened handle on the file, so that the process may close
+	its descriptor meanwhile.  A worker adopts the process's page
+	directory while it runs a request, copies to or from the user
+	buffer through the usual fault-recovering routines, and posts
+	the completion itself.
+
+	The kernel never takes a submission unless the completion
+	queue is sure to have room for it, counting requests still in
+	flight, so completions are never dropped.
+
+	The process can write anything into the header, so the kernel
+	keeps its own copy of the ring's layout and of the indexes it
+	advances, and uses the header's SQ_TAIL and CQ_HEAD only as
+	untrusted counts. */
+
+/* Number of worker threads for ring requests. */
+#define IORING_WORKERS 4
+
+/* Kernel state for a process's ring. */
+struct ioring {
+	struct ioring_hdr* hdr;	 /* Shared mapping, kernel address. */
+	uint8_t* base;				 /* Shared mapping, user address. */
+	size_t page_cnt;			 /* Number of pages at HDR. */
+	struct ioring_sqe* sqes;	 /* Submission entries, kernel address. */
+	struct ioring_cqe* cqes;	 /* Completion entries, kernel address. */
+	uint32_t sq_entries;		 /* Submission queue size. */
+	uint32_t cq_entries;		 /* Completion queue size. */
+	uint32_t sq_head;			 /* Next submission to take. */
+	uint32_t* pagedir;		 /* Owner's page directory. */
+#ifdef VM
+	struct page_table* pages; /* Owner's supplemental page table. */
+#endif
+	uint32_t cq_tail;			 /* Next completion to post. */
+	struct lock lock;			 /* Protects CQ_TAIL and INFLIGHT. */
+	struct condition posted; /* Signaled on each completion. */
+	unsigned inflight;		 /* Requests queued to workers. */
+};
+
+/* A read or write handed to a worker. */
+struct ioring_req {
+	struct work work;			/* Work queue item. */
+	struct ioring* ring;		/* Ring to complete on. */
+	struct ioring_sqe sqe;	/* Copy of the submission. */
+	struct file* file;		/* Private handle on the file. */
+};
+
+/* Work queue that runs ring requests. */
+static struct workqueue* ioring_wq;
+
+/* Creates the work queue.  Its threads start on first use. */
+void ioring_init(void)
+{
+	ioring_wq = workqueue_create("ioring", IORING_WORKERS);
+	ASSERT(ioring_wq != NULL);
+}
+
+/* Posts a completion for USER_DATA with result RES on RING.
+	RING's lock must be held. */
+static void post(struct ioring* ring, uint32_t user_data, int32_t res)
+{
+	struct ioring_cqe* cqe = &ring->cqes[ring->cq_tail & (ring->cq_entries - 1)];
+
+	ASSERT(lock_held_by_current_thread(&ring->lock));
+
+	cqe->user_data = user_data;
+	cqe->res = res;
+	ioring_barrier();
+	ring->hdr->cq_tail = ++ring->cq_tail;
+	cond_broadcast(&ring->posted, &ring->lock);
+}
+
+/* Returns the number of completions RING's owner has not yet
+	consumed, treating a nonsensical CQ_HEAD as a full queue. */
+static uint32_t cq_used(const struct ioring* ring)
+{
+	uint32_t used = ring->cq_tail - ring->hdr->cq_head;
+	return used <= ring->cq_entries ? used : ring->cq_entries;
+}
+
+/* Runs the read or write in AUX, a struct ioring_req, in a worker
+	thread. */
+static void run_request(void* aux)
+{
+	struct ioring_req* r = aux;
+	struct ioring* ring = r->ring;
+	struct thread* cur = thread_current();
+	uint8_t* kbuf = palloc_get_page(0);
+	bool writing = r->sqe.opcode == IORING_OP_WRITE;
+	uint8_t* ubuf = r->sqe.addr;
+	bool fault = false;
+	int32_t res = -1;
+
+	/* Make the owner's user memory addressable. */
+	cur->pagedir = ring->pagedir;
+#ifdef VM
+	cur->pages = ring->pages;
+#endif
+	pagedir_activate(cur->pagedir);
+
+	if (kbuf != NULL) {
+		uint32_t done = 0;
+
+		while (done < r->sqe.len) {
+			uint32_t chunk = r->sqe.len - done < PGSIZE ? r->sqe.len - done : PGSIZE;
+			off_t ofs = r->sqe.offset + done;
+			uint32_t moved;
+
+			if (writing) {
+				fault = !copy_from_user(kbuf, ubuf + done, chunk);
+				if (fault)
+					break;
+				moved = file_write_at(r->file, kbuf, chunk, ofs);
+			} else {
+				moved = file_read_at(r->file, kbuf, chunk, ofs);
+				fault = !copy_to_user(ubuf + done, kbuf, moved);
+				if (fault)
+					break;
+			}
+			done += moved;
+			if (moved < chunk)
+				break;
+		}
+
+		/* A fault before anything moved is an error; after, a
+			short count, as for read() and write(). */
+		res = fault && done == 0 ? -1 : (int32_t) done;
+		palloc_free_page(kbuf);
+	}
+
+	cur->pagedir = NULL;
+#ifdef VM
+	cur->pages = NULL;
+#endif
+	pagedir_activate(NULL);
+
+	file_close(r->file);
+
+	lock_acquire(&ring->lock);
+	post(ring, r->sqe.user_data, res);
+	ring->inflight--;
+	lock_release(&ring->lock);
+
+	free(r);
+}
+
+/* Starts the read or write SQE on RING.  Returns false if it
+	failed at once, in which case the caller posts -1. */
+static bool start_request(struct ioring* ring, const struct ioring_sqe* sqe)
+{
+	struct file* file = fd_lookup(&thread_current()->fds, sqe->fd);
+	struct ioring_req* r;
+
+	if (file == NULL || sqe->offset > INT32_MAX || !user_range_ok(sqe->addr, sqe->len))
+		return false;
+
+	r = malloc(sizeof *r);
+	if (r == NULL)
+		return false;
+	r->file = file_reopen(file);
+	if (r->file == NULL) {
+		free(r);
+		return false;
+	}
+	r->ring = ring;
+	r->sqe = *sqe;
+
+	lock_acquire(&ring->lock);
+	ring->inflight++;
+	lock_release(&ring->lock);
+
+	work_init(&r->work, run_request, r, WORK_PRI_NORMAL);
+	work_queue(ioring_wq, &r->work);
+	return true;
+}
+
+/* Carries out SQE, taken from RING's submission queue. */
+static void submit(struct ioring* ring, const struct ioring_sqe* sqe)
+{
+	int32_t res = -1;
+
+	if (sqe->flags == 0 && sqe->reserved == 0) {
+		switch (sqe->opcode) {
+			case IORING_OP_NOP:
+				res = 0;
+				break;
+
+			case IORING_OP_READ:
+			case IORING_OP_WRITE:
+				if (start_request(ring, sqe))
+					return;
+				break;
+
+			case IORING_OP_OPEN: {
+				char* name = palloc_get_page(0);
+				if (name != NULL) {
+					int len = strncpy_from_user(name, sqe->addr, PGSIZE);
+					if (len >= 0 && len < PGSIZE)
+						res = open(name);
+					palloc_free_page(name);
+				}
+				}
+				break;
+
+			case IORING_OP_CLOSE:
+				if (fd_close(&thread_current()->fds, sqe->fd))
+					res = 0;
+				break;
+		}
+	}
+
+	lock_acquire(&ring->lock);
+	post(ring, sqe->user_data, res);
+	lock_release(&ring->lock);
+}
+
+/* Maps a ring with ENTRIES submission queue entries at user
+	address ADDR, which must be page-aligned and unmapped, and
+	under VM must not be in the supplemental page table either.  ENTRIES
+	must be a power of 2 no greater than IORING_MAX_ENTRIES.  Each
+	process may have one ring.  Returns 0 if successful, -1
+	otherwise. */
+int ioring_setup(unsigned entries, void* addr)
+{
+	struct thread* cur = thread_current();
+	size_t page_cnt, i;
+	struct ioring* ring;
+	uint8_t* kpages;
+
+	if (cur->ioring != NULL || entries == 0 || entries > IORING_MAX_ENTRIES
+		 || (entries & (entries - 1)) != 0 || addr == NULL || pg_ofs(addr) != 0)
+		return -1;
+
+	page_cnt = DIV_ROUND_UP(ioring_size(entries), PGSIZE);
+	if (!user_range_ok(addr, page_cnt * PGSIZE))
+		return -1;
+	for (i = 0; i < page_cnt; i++)
+		if (pagedir_get_page(cur->pagedir, (uint8_t*) addr + i * PGSIZE) != NULL)
+			return -1;
+#ifdef VM
+	/* Pages that are not loaded yet are not in the page directory. */
+	if (page_range_used(cur->pages, addr, page_cnt))
+		return -1;
+#endif
+
+	ring = malloc(sizeof *ring);
+	if (ring == NULL)
+		return -1;
+	kpages = palloc_get_multiple(PAL_USER | PAL_ZERO, page_cnt);
+	if (kpages == NULL) {
+		free(ring);
+		return -1;
+	}
+
+	/* Once mapped, the pages belong to the page directory, which
+		frees them when the process exits. */
+	for (i = 0; i < page_cnt; i++)
+		if (!pagedir_set_page(cur->pagedir, (uint8_t*) addr + i * PGSIZE,
+									 kpages + i * PGSIZE, true)) {
+			pagedir_clear_range(cur->pagedir, addr, i);
+			palloc_free_multiple(kpages, page_cnt);
+			free(ring);
+			return -1;
+		}
+
+	ring->hdr = (struct ioring_hdr*) kpages;
+	ring->base = addr;
+	ring->page_cnt = page_cnt;
+	ring->hdr->sq_entries = entries;
+	ring->hdr->cq_entries = 2 * entries;
+	ring->hdr->sqes_off = sizeof(struct ioring_hdr);
+	ring->hdr->cqes_off = sizeof(struct ioring_hdr) + entries * sizeof(struct ioring_sqe);
+	ring->sq_entries = entries;
+	ring->cq_entries = 2 * entries;
+	ring->sqes = (struct ioring_sqe*) (kpages + sizeof(struct ioring_hdr));
+	ring->cqes = (struct ioring_cqe*) (ring->sqes + entries);
+	ring->sq_head = ring->cq_tail = 0;
+	ring->pagedir = cur->pagedir;
+#ifdef VM
+	ring->pages = cur->pages;
+#endif
+	lock_init_named(&ring->lock, "ioring");
+	cond_init(&ring->posted);
+	ring->inflight = 0;
+	cur->ioring = ring;
+	return 0;
+}
+
+/* Hands up to TO_SUBMIT entries from the current process's
+	submission queue to the kernel, then waits until at least
+	MIN_COMPLETE completions are waiting to be consumed or no
+	requests remain in flight.  Returns the number of entries
+	taken, or -1 if the process has no ring or its SQ_TAIL is
+	more than a queue's worth ahead of SQ_HEAD. */
+int ioring_enter(unsigned to_submit, unsigned min_complete)
+{
+	struct ioring* ring = thread_current()->ioring;
+	struct ioring_hdr* h;
+	unsigned submitted = 0;
+
+	if (ring == NULL)
+		return -1;
+	h = ring->hdr;
+
+	if (h->sq_tail - ring->sq_head > ring->sq_entries)
+		return -1;
+
+	while (submitted < to_submit) {
+		uint32_t head = ring->sq_head;
+		struct ioring_sqe sqe;
+		bool room;
+
+		if (head == h->sq_tail)
+			break;
+
+		/* Take the entry only if its completion is sure to fit. */
+		lock_acquire(&ring->lock);
+		room = cq_used(ring) + ring->inflight < ring->cq_entries;
+		lock_release(&ring->lock);
+		if (!room)
+			break;
+
+		ioring_barrier();
+		sqe = ring->sqes[head & (ring->sq_entries - 1)];
+		ring->sq_head = head + 1;
+		h->sq_head = ring->sq_head;
+		submit(ring, &sqe);
+		submitted++;
+	}
+
+	if (min_complete > ring->cq_entries)
+		min_complete = ring->cq_entries;
+	lock_acquire(&ring->lock);
+	while (cq_used(ring) < min_complete && ring->inflight > 0)
+		cond_wait(&ring->posted, &ring->lock);
+	lock_release(&ring->lock);
+
+	return submitted;
+}
+
+/* Waits for T's ring requests to finish and frees its ring.  Must
+	be called before T's page directory is destroyed. */
+void ioring_destroy(struct thread* t)
+{
+	struct ioring* ring = t->ioring;
+
+	if (ring == NULL)
+		return;
+
+	lock_acquire(&ring->lock);
+	while (ring->inflight > 0)
+		cond_wait(&ring->posted, &ring->lock);
+	lock_release(&ring->lock);
+
+	t->ioring = NULL;
+	free(ring);
+}
+
+/* Returns true if kernel page KPAGE is part of T's ring, which
+	the kernel keeps using for as long as T lives. */
+bool ioring_owns_page(struct thread* t, const void* kpage)
+{
+	struct ioring* ring = t->ioring;
+	const uint8_t* base;
+
+	if (ring == NULL)
+		return false;
+	base = (const uint8_t*) ring->hdr;
+	return (const uint8_t*) kpage >= base
+			 && (const uint8_t*) kpage < base + ring->page_cnt * PGSIZE;
+}
+
+/* Returns true if the SIZE bytes of user memory at ADDR overlap
+	T's ring, whose pages nothing else may map or free. */
+bool ioring_overlaps(struct thread* t, const void* addr, size_t size)
+{
+	struct ioring* ring = t->ioring;
+	const uint8_t* start = addr;
+
+	if (ring == NULL || size == 0)
+		return false;
+	return start < ring->base + ring->page_cnt * PGSIZE && ring->base < start + size;
+}
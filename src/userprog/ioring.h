@@ -0,0 +1,14 @@
+#ifndef USERPROG_IORING_H
+#define USERPROG_IORING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct thread;
+
+void ioring_init(void);
+void ioring_destroy(struct thread*);
+bool ioring_owns_page(struct thread*, const void* kpage);
+bool ioring_overlaps(struct thread*, const void* addr, size_t size);
+
+#endif /* userprog/ioring.h */
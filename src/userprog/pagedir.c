@@ -6,10 +6,19 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 
+/* Range operations touching more pages than this flush the
+	whole TLB once instead of invalidating each page. */
+#define INVLPG_MAX 32
+
+/* TLB statistics. */
+static long long full_flush_cnt;   /* # of CR3 reloads. */
+static long long page_flush_cnt;   /* # of single-page invalidations. */
+
 static uint32_t* active_pd(void);
-static void invalidate_pagedir(uint32_t*);
+static void invalidate_page(uint32_t*, const void*);
 
 /* Creates a new page directory that has mappings for kernel
 	virtual addresses, but none for user virtual addresses.
@@ -143,10 +152,48 @@ void pagedir_clear_page(uint32_t* pd, void* upage)
 	pte = lookup_page(pd, upage, false);
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		invalidate_pagedir(pd);
+		invalidate_page(pd, upage);
 	}
 }
 
+/* Marks the PAGE_CNT user virtual pages starting at UPAGE "not
+	present" in page directory PD, as pagedir_clear_page() does
+	for each of them, but invalidates the TLB only once a large
+	range has been cleared.  The pages need not be mapped. */
+void pagedir_clear_range(uint32_t* pd, void* upage, size_t page_cnt)
+{
+	uint8_t* start = upage;
+	size_t cleared = 0;
+	size_t i;
+
+	ASSERT(pg_ofs(upage) == 0);
+	ASSERT(is_user_vaddr(start + page_cnt * PGSIZE - 1));
+
+	for (i = 0; i < page_cnt; i++) {
+		uint32_t* pte = lookup_page(pd, start + i * PGSIZE, false);
+		if (pte != NULL && (*pte & PTE_P) != 0) {
+			*pte &= ~PTE_P;
+			cleared++;
+		}
+	}
+
+	if (cleared == 0 || active_pd() != pd)
+		return;
+	if (page_cnt > INVLPG_MAX)
+		pagedir_activate(pd);
+	else
+		for (i = 0; i < page_cnt; i++)
+			invalidate_page(pd, start + i * PGSIZE);
+}
+
+/* Returns true if VPAGE is mapped in PD and user code may write
+	to it. */
+bool pagedir_is_writable(uint32_t* pd, const void* vpage)
+{
+	uint32_t* pte = lookup_page(pd, vpage, false);
+	return pte != NULL && (*pte & PTE_P) != 0 && (*pte & PTE_W) != 0;
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
 	that is, if the page has been modified since the PTE was
 	installed.
@@ -167,7 +214,7 @@ void pagedir_set_dirty(uint32_t* pd, const void* vpage, bool dirty)
 			*pte |= PTE_D;
 		else {
 			*pte &= ~(uint32_t) PTE_D;
-			invalidate_pagedir(pd);
+			invalidate_page(pd, vpage);
 		}
 	}
 }
@@ -192,7 +239,7 @@ void pagedir_set_accessed(uint32_t* pd, const void* vpage, bool accessed)
 			*pte |= PTE_A;
 		else {
 			*pte &= ~(uint32_t) PTE_A;
-			invalidate_pagedir(pd);
+			invalidate_page(pd, vpage);
 		}
 	}
 }
@@ -208,8 +255,17 @@ void pagedir_activate(uint32_t* pd)
 		aka PDBR (page directory base register).  This activates our
 		new page tables immediately.  See [IA32-v2a] "MOV--Move
 		to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
-		Address of the Page Directory". */
+		Address of the Page Directory".  This also flushes the
+		whole TLB. */
 	asm volatile("movl %0, %%cr3" : : "r"(vtop(pd)) : "memory");
+	full_flush_cnt++;
+}
+
+/* Prints TLB statistics. */
+void pagedir_print_stats(void)
+{
+	printf("TLB: %lld full flushes, %lld single-page flushes\n",
+			 full_flush_cnt, page_flush_cnt);
 }
 
 /* Returns the currently active page directory. */
@@ -224,19 +280,22 @@ static uint32_t* active_pd(void)
 	return ptov(pd);
 }
 
-/* Seom page table changes can cause the CPU's translation
+/* Some page table changes can cause the CPU's translation
 	lookaside buffer (TLB) to become out-of-sync with the page
-	table.  When this happens, we have to "invalidate" the TLB by
-	re-activating it.
-
-	This function invalidates the TLB if PD is the active page
-	directory.  (If PD is not active then its entries are not in
-	the TLB, so there is no need to invalidate anything.) */
-static void invalidate_pagedir(uint32_t* pd)
+	table.  When this happens, we have to "invalidate" the stale
+	entry.
+
+	This function invalidates the TLB entry for VADDR if PD is
+	the active page directory.  (If PD is not active then its
+	entries are not in the TLB, so there is no need to
+	invalidate anything.)  Unlike re-activating PD, INVLPG
+	leaves the rest of the TLB intact.  See [IA32-v2a] "INVLPG--
+	Invalidate TLB Entry" and [IA32-v3a] 3.12 "Translation
+	Lookaside Buffers (TLBs)". */
+static void invalidate_page(uint32_t* pd, const void* vaddr)
 {
 	if (active_pd() == pd) {
-		/* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-			"Translation Lookaside Buffers (TLBs)". */
-		pagedir_activate(pd);
+		asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
+		page_flush_cnt++;
 	}
 }
@@ -0,0 +1,267 @@
+#include "userprog/pipe.h"
+
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/ioring.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+#include <debug.h>
+#include <stdint.h>
+
+/* Anonymous pipes.
+
+	A pipe buffers data in a small ring of pages.  Writers append
+	to the page at the tail, starting a new one when it fills, and
+	readers consume from the page at the head, freeing it once it
+	is empty.  Both sides block on condition variables: readers
+	until there is data or no writer is left, writers until there
+	is a free page.  A writer that finds the user pool empty while
+	the pipe holds nothing for a reader to drain has nobody to wake
+	it, so it sleeps a tick and tries again.
+
+	The pages come from the user pool, so a page that a writer
+	filled completely can be handed to a reader whole: if the
+	reader's buffer covers an entire page-aligned page, the pipe
+	page is mapped there in place of the reader's page, which the
+	pipe frees, instead of being copied.  A full-page transfer
+	therefore costs one copy, on the write side, rather than two.
+	The writer keeps its own data, so its side always copies. */
+
+/* Number of pages a pipe may buffer. */
+#define PIPE_PAGES 16
+
+/* One buffered page. */
+struct pipe_page {
+	uint8_t* kpage; /* Page, from the user pool. */
+	size_t ofs;		 /* Offset of the first unread byte. */
+	size_t len;		 /* Number of unread bytes. */
+};
+
+/* An anonymous pipe, shared by every descriptor open on either
+	end. */
+struct pipe {
+	struct lock lock;						 /* Protects all members. */
+	struct condition not_empty;		 /* Signaled when data arrives or writers leave. */
+	struct condition not_full;			 /* Signaled when pages free up or readers leave. */
+	struct pipe_page pages[PIPE_PAGES]; /* Ring of buffered pages. */
+	size_t head;							 /* Index of the oldest page. */
+	size_t cnt;								 /* Number of pages in use. */
+	size_t bytes;							 /* Number of unread bytes. */
+	int readers;							 /* Descriptors open on the read end. */
+	int writers;							 /* Descriptors open on the write end. */
+};
+
+/* Creates a pipe with one descriptor's worth of references on
+	each end.  Returns a null pointer if memory is exhausted. */
+struct pipe* pipe_create(void)
+{
+	struct pipe* p = malloc(sizeof *p);
+
+	if (p == NULL)
+		return NULL;
+	lock_init_named(&p->lock, "pipe");
+	cond_init(&p->not_empty);
+	cond_init(&p->not_full);
+	p->head = p->cnt = p->bytes = 0;
+	p->readers = p->writers = 1;
+	return p;
+}
+
+/* Adds a reference to P's write end if WRITE_END is true,
+	otherwise to its read end. */
+void pipe_dup(struct pipe* p, bool write_end)
+{
+	lock_acquire(&p->lock);
+	if (write_end)
+		p->writers++;
+	else
+		p->readers++;
+	lock_release(&p->lock);
+}
+
+/* Drops a reference to P's write end if WRITE_END is true,
+	otherwise to its read end, waking anybody waiting on the
+	other end.  Frees P when no references remain. */
+void pipe_close(struct pipe* p, bool write_end)
+{
+	bool dead;
+
+	lock_acquire(&p->lock);
+	if (write_end) {
+		ASSERT(p->writers > 0);
+		p->writers--;
+	} else {
+		ASSERT(p->readers > 0);
+		p->readers--;
+	}
+	cond_broadcast(&p->not_empty, &p->lock);
+	cond_broadcast(&p->not_full, &p->lock);
+	dead = p->readers == 0 && p->writers == 0;
+	lock_release(&p->lock);
+
+	if (dead) {
+		for (; p->cnt > 0; p->cnt--) {
+			palloc_free_page(p->pages[p->head].kpage);
+			p->head = (p->head + 1) % PIPE_PAGES;
+		}
+		free(p);
+	}
+}
+
+/* Gives up P's lock and kills the current process, whose buffer
+	was not mapped. */
+static void bad_buffer(struct pipe* p)
+{
+	lock_release(&p->lock);
+	exit(-1);
+}
+
+/* Maps KPAGE, which must hold a full page of pipe data, at user
+	page UPAGE of the current process in place of the page there,
+	and frees that page.  Declines, returning false, if UPAGE is
+	not mapped writable or is shared with the kernel. */
+static bool hand_off(uint8_t* upage, uint8_t* kpage)
+{
+#ifdef VM
+	/* The frame table must learn of the new frame. */
+	return page_donate(upage, kpage);
+#else
+	struct thread* t = thread_current();
+	void* old = pagedir_get_page(t->pagedir, upage);
+
+	if (old == NULL || !pagedir_is_writable(t->pagedir, upage)
+		 || ioring_owns_page(t, old))
+		return false;
+
+	/* The page table already exists, so this cannot fail. */
+	pagedir_clear_page(t->pagedir, upage);
+	if (!pagedir_set_page(t->pagedir, upage, kpage, true))
+		PANIC("pipe: remapping user page failed");
+	palloc_free_page(old);
+	return true;
+#endif
+}
+
+/* Reads up to SIZE bytes from P into user buffer UBUF.  If WAIT
+	is true and P is empty, first blocks until data arrives or
+	every writer has closed.  Returns the number of bytes read,
+	which is 0 at end of file.  Kills the process if UBUF is not
+	mapped. */
+int pipe_read(struct pipe* p, void* ubuf_, size_t size, bool wait)
+{
+	uint8_t* ubuf = ubuf_;
+	size_t done = 0;
+
+	lock_acquire(&p->lock);
+	while (wait && p->bytes == 0 && p->writers > 0)
+		cond_wait(&p->not_empty, &p->lock);
+
+	while (done < size && p->bytes > 0) {
+		struct pipe_page* pg = &p->pages[p->head];
+		size_t n = size - done < pg->len ? size - done : pg->len;
+
+		if (pg->ofs == 0 && pg->len == PGSIZE && n == PGSIZE
+			 && pg_ofs(ubuf + done) == 0 && hand_off(ubuf + done, pg->kpage)) {
+			pg->kpage = NULL;
+			pg->len = 0;
+		} else {
+			if (!copy_to_user(ubuf + done, pg->kpage + pg->ofs, n))
+				bad_buffer(p);
+			pg->ofs += n;
+			pg->len -= n;
+		}
+		done += n;
+		p->bytes -= n;
+
+		/* The tail page may yet be appended to; any other page is
+			done with once it is empty. */
+		if (pg->len == 0 && (p->cnt > 1 || pg->kpage == NULL)) {
+			if (pg->kpage != NULL)
+				palloc_free_page(pg->kpage);
+			p->head = (p->head + 1) % PIPE_PAGES;
+			p->cnt--;
+		}
+	}
+
+	if (done > 0)
+		cond_broadcast(&p->not_full, &p->lock);
+	lock_release(&p->lock);
+	return done;
+}
+
+/* Returns the page at the tail of P that has room for more data,
+	adding a page if need be.  Returns a null pointer if P already
+	has as many pages as it may, or if no page is free. */
+static struct pipe_page* tail_page(struct pipe* p)
+{
+	struct pipe_page* pg;
+
+	if (p->cnt > 0) {
+		pg = &p->pages[(p->head + p->cnt - 1) % PIPE_PAGES];
+		if (pg->len == 0)
+			pg->ofs = 0;
+		if (pg->ofs + pg->len < PGSIZE)
+			return pg;
+	}
+	if (p->cnt == PIPE_PAGES)
+		return NULL;
+
+	pg = &p->pages[(p->head + p->cnt) % PIPE_PAGES];
+	pg->kpage = palloc_get_page(PAL_USER);
+	if (pg->kpage == NULL)
+		return NULL;
+	pg->ofs = pg->len = 0;
+	p->cnt++;
+	return pg;
+}
+
+/* Writes SIZE bytes from user buffer UBUF into P, blocking while
+	P is full or no page is free.  Returns the number of bytes
+	written, which is less than SIZE only if every reader has
+	closed, or -1 if that happened before anything was written.
+	Kills the process if UBUF is not mapped. */
+int pipe_write(struct pipe* p, const void* ubuf_, size_t size)
+{
+	const uint8_t* ubuf = ubuf_;
+	size_t done = 0;
+
+	lock_acquire(&p->lock);
+	while (done < size && p->readers > 0) {
+		struct pipe_page* pg = tail_page(p);
+		size_t room, n;
+
+		if (pg == NULL) {
+			/* Full, or out of pages: wait for a reader to drain
+				some.  If there is nothing to drain, wait for some
+				other page to be freed instead. */
+			if (p->cnt == 0) {
+				lock_release(&p->lock);
+				timer_sleep(1);
+				lock_acquire(&p->lock);
+			} else
+				cond_wait(&p->not_full, &p->lock);
+			continue;
+		}
+
+		room = PGSIZE - (pg->ofs + pg->len);
+		n = size - done < room ? size - done : room;
+		if (!copy_from_user(pg->kpage + pg->ofs + pg->len, ubuf + done, n))
+			bad_buffer(p);
+		pg->len += n;
+		p->bytes += n;
+		done += n;
+		cond_broadcast(&p->not_empty, &p->lock);
+	}
+	lock_release(&p->lock);
+
+	return done == 0 && size > 0 ? -1 : (int) done;
+}
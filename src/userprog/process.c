@@ -16,6 +16,11 @@
 #include "lib/kernel/list.h"
 #include "threads/malloc.h"
 #include "userprog/syscall.h"
+#include "userprog/ioring.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 #include <stdlib.h>
 #include <debug.h>
@@ -29,6 +34,7 @@ struct shared_variables {
 	bool success;
 	tid_t child_id;
 	char* cmd_line_;
+	struct thread* parent;
 };
 
 static thread_func start_process NO_RETURN;
@@ -51,6 +57,7 @@ tid_t process_execute(const char* cmd_line)
 	// Context of parent
 	struct shared_variables shared;
 	sema_init(&shared.sema, 0);
+	shared.parent = thread_current();
 	cl_copy = shared.cmd_line_ = palloc_get_page(0);
 
 	if (cl_copy == NULL)
@@ -198,6 +205,12 @@ static void start_process(void* cmd_line_)
 	// Note: load requires the file name only, not the entire cmd_line
 	//success = load(t->name, &if_.eip, &if_.esp);
 
+	// Pipes are inherited, so that a parent can talk to its child.
+	// The parent is blocked until we signal, so its table holds still.
+	if (success) {
+		success = fd_table_inherit(&thread_current()->fds, &shared->parent->fds);
+	}
+
 	// Update success value of struct
 	shared->success = success;
 	sema_up(&shared->sema);
@@ -258,6 +271,13 @@ void process_exit(void)
 {
 	struct thread* cur = thread_current();
 
+	// Free what the system call we are dying in copied in
+	syscall_release_pending();
+
+	// Let outstanding ring requests finish while the address
+	// space and files they use still exist
+	ioring_destroy(cur);
+
 	// Lock while decrementing alive count
 	if (cur->parent_child == NULL) {
 		// If cur is root node, just clean up its children and close files.
@@ -291,6 +311,17 @@ void process_exit(void)
 	
 	uint32_t* pd;
 
+#ifdef VM
+	/* Give back our frames while the page directory that maps
+		them still exists, writing back changed pages of mapped
+		files.  Nothing can fault on our pages now. */
+	mmap_unmap_all();
+	page_table_destroy(cur->pages);
+	cur->pages = NULL;
+	file_close(cur->exec_file);
+	cur->exec_file = NULL;
+#endif
+
 	/* Destroy the current process's page directory and switch back
 		to the kernel-only page directory. */
 	pd = cur->pagedir;
@@ -310,12 +341,7 @@ void process_exit(void)
 
 void close_files(struct thread* cur) {
 	// close any open file related to current thread
-	for (int i = 0; i < MAX_FILES; i++){
-
-		if(cur->OPEN_FILES[i] != NULL){
-			file_close(cur->OPEN_FILES[i]);
-		}
-	}
+	fd_table_destroy(&cur->fds);
 }
 
 void cleanup_children(struct thread* cur) {
@@ -440,6 +466,7 @@ bool load(const char* file_name, void (**eip)(void), void** esp)
 	struct file* file = NULL;
 	off_t file_ofs;
 	bool success = false;
+	uint8_t* image_end = NULL;
 	int i;
 
 	/* Allocate and activate page directory. */
@@ -448,6 +475,13 @@ bool load(const char* file_name, void (**eip)(void), void** esp)
 		goto done;
 	process_activate();
 
+#ifdef VM
+	/* Pages are loaded on first touch; this tracks where from. */
+	t->pages = page_table_create();
+	if (t->pages == NULL)
+		goto done;
+#endif
+
 	/* Open executable file. */
 	file = filesys_open(file_name);
 	if (file == NULL) {
@@ -516,6 +550,8 @@ bool load(const char* file_name, void (**eip)(void), void** esp)
 							  zero_bytes,
 							  writable))
 						goto done;
+					if ((uint8_t*) mem_page + read_bytes + zero_bytes > image_end)
+						image_end = (uint8_t*) mem_page + read_bytes + zero_bytes;
 				}
 				else
 					goto done;
@@ -527,6 +563,11 @@ bool load(const char* file_name, void (**eip)(void), void** esp)
 	if (!setup_stack(esp))
 		goto done;
 
+	/* The heap starts out empty, just past the executable. */
+	if (image_end == NULL || image_end > USER_STACK_BOTTOM)
+		goto done;
+	t->heap_base = t->brk = image_end;
+
 	/* Start address. */
 	*eip = (void (*)(void)) ehdr.e_entry;
 
@@ -534,13 +575,25 @@ bool load(const char* file_name, void (**eip)(void), void** esp)
 
 done:
 	/* We arrive here whether the load is successful or not. */
+#ifdef VM
+	/* The executable backs pages that are not loaded yet, so it
+		stays open, with writes to it denied, as long as the
+		process lives.  file_close() allows writes again. */
+	if (success) {
+		file_deny_write(file);
+		t->exec_file = file;
+		return true;
+	}
+#endif
 	file_close(file);
 	return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page(void* upage, void* kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
 	FILE and returns true if so, false otherwise. */
@@ -612,6 +665,25 @@ static bool load_segment(
 	ASSERT(pg_ofs(upage) == 0);
 	ASSERT(ofs % PGSIZE == 0);
 
+#ifdef VM
+	/* Only record where each page comes from.  page_fault_in()
+		reads it in when it is first touched. */
+	while (read_bytes > 0 || zero_bytes > 0) {
+		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+		size_t page_zero_bytes = PGSIZE - page_read_bytes;
+
+		if (!page_add_file(
+				  thread_current()->pages, upage, file, ofs, page_read_bytes, writable))
+			return false;
+
+		/* Advance. */
+		read_bytes -= page_read_bytes;
+		zero_bytes -= page_zero_bytes;
+		upage += PGSIZE;
+		ofs += PGSIZE;
+	}
+	return true;
+#else
 	file_seek(file, ofs);
 	while (read_bytes > 0 || zero_bytes > 0) {
 		/* Calculate how to fill this page.
@@ -644,12 +716,25 @@ static bool load_segment(
 		upage += PGSIZE;
 	}
 	return true;
+#endif
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
-	user virtual memory. */
+	user virtual memory.  Under VM, the stack grows from there on
+	demand, down to USER_STACK_BOTTOM. */
 static bool setup_stack(void** esp)
 {
+#ifdef VM
+	uint8_t* upage = ((uint8_t*) PHYS_BASE) - PGSIZE;
+
+	/* The arguments go here next, so bring it in right away, in a
+		frame of its own. */
+	if (!page_add_zero(thread_current()->pages, upage, true)
+		 || !page_fault_in(upage, NULL, true))
+		return false;
+	*esp = PHYS_BASE;
+	return true;
+#else
 	uint8_t* kpage;
 	bool success = false;
 
@@ -662,8 +747,10 @@ static bool setup_stack(void** esp)
 			palloc_free_page(kpage);
 	}
 	return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
 	virtual address KPAGE to the page table.
 	If WRITABLE is true, the user process may modify the page;
@@ -683,6 +770,72 @@ static bool install_page(void* upage, void* kpage, bool writable)
 		 pagedir_get_page(t->pagedir, upage) == NULL
 		 && pagedir_set_page(t->pagedir, upage, kpage, writable));
 }
+#endif
+
+/* Unmaps and frees the user pages from START up to END, both
+	page-aligned. */
+static void free_heap_pages(uint8_t* start, uint8_t* end)
+{
+	struct thread* t = thread_current();
+
+	for (; start < end; start += PGSIZE) {
+#ifdef VM
+		page_remove(t->pages, start);
+#else
+		void* kpage = pagedir_get_page(t->pagedir, start);
+		pagedir_clear_page(t->pagedir, start);
+		palloc_free_page(kpage);
+#endif
+	}
+}
+
+/* Adds a zeroed, writable heap page at UPAGE.  Under VM the page
+	gets a frame only when first touched. */
+static bool add_heap_page(uint8_t* upage)
+{
+#ifdef VM
+	return page_add_zero(thread_current()->pages, upage, true);
+#else
+	uint8_t* kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+
+	if (kpage == NULL || !install_page(upage, kpage, true)) {
+		palloc_free_page(kpage);
+		return false;
+	}
+	return true;
+#endif
+}
+
+/* Moves the current process's heap break by INCREMENT bytes,
+	mapping zeroed pages as it grows and freeing them as it
+	shrinks.  Returns the old break, or (void*) -1 if the heap
+	would shrink below its start or grow into the stack area or
+	another mapping, or if memory is exhausted. */
+void* process_sbrk(int increment)
+{
+	struct thread* t = thread_current();
+	uint8_t* old = t->brk;
+	uint8_t* new = old + increment;
+	uint8_t* upage;
+
+	if (increment < 0) {
+		if (new < t->heap_base || new > old)
+			return (void*) -1;
+		free_heap_pages(pg_round_up(new), pg_round_up(old));
+	} else {
+		if (new < old || new > USER_STACK_BOTTOM || ioring_overlaps(t, old, new - old))
+			return (void*) -1;
+		for (upage = pg_round_up(old); upage < new; upage += PGSIZE) {
+			if (!add_heap_page(upage)) {
+				free_heap_pages(pg_round_up(old), upage);
+				return (void*) -1;
+			}
+		}
+	}
+
+	t->brk = new;
+	return old;
+}
 
 // Don't raise a warning about unused function.
 // We know that dump_stack might not be called, this is fine.
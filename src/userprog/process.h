@@ -2,10 +2,20 @@
 #define USERPROG_PROCESS_H
 
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Address space reserved below PHYS_BASE for the user stack.  The
+	heap may not grow into it, and under VM the stack grows on
+	demand to fill it.  A build may define a different size. */
+#ifndef USER_STACK_MAX
+#define USER_STACK_MAX (8 * 1024 * 1024)
+#endif
+#define USER_STACK_BOTTOM ((uint8_t*) PHYS_BASE - USER_STACK_MAX)
 
 tid_t process_execute(const char* cmd_line);
 int process_wait(tid_t);
 void process_exit(void);
 void process_activate(void);
+void* process_sbrk(int increment);
 
 #endif /* userprog/process.h */
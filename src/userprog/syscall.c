@@ -10,7 +10,17 @@
 #include "filesys/file.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
-#include "userprog/pagedir.h"
+#include "userprog/tss.h"
+#include "userprog/uaccess.h"
+#include "userprog/fdtable.h"
+#include "userprog/ioring.h"
+#include "userprog/pipe.h"
+#include "threads/palloc.h"
+#include "threads/malloc.h"
+#include "threads/loader.h"
+#ifdef VM
+#include "vm/mmap.h"
+#endif
 
 #include <stdio.h>
 #include <syscall-nr.h>
@@ -18,254 +28,639 @@
 #include <stdbool.h>
 #include <kernel/stdio.h>
 #include <string.h>
+#include <cpu.h>
+#include <limits.h>
 
 
 
+/* Model-specific registers that configure SYSENTER.
+	See [IA32-v3a] 5.8.7 "Performing Fast Calls to System
+	Procedures with the SYSENTER and SYSEXIT Instructions". */
+#define MSR_SYSENTER_CS 0x174	/* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175 /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176 /* Kernel entry point. */
+
 static void syscall_handler(struct intr_frame*);
+void syscall_sysenter(struct intr_frame*);
+void sysenter_entry(void);
 int read_from_stdin(char* buffer, int size);
-bool is_valid_ptr(const void* ptr);
-bool is_valid_string(const char* s);
-bool is_valid_buffer(const void* buffer, unsigned length);
 bool is_valid_fd(int fd);
 
 void syscall_init(void)
 {
 	intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
+	ioring_init();
+
+	/* Also accept system calls through SYSENTER, which avoids the
+		IDT lookup, privilege checks, and stack frame of a software
+		interrupt.  User programs probe for the instruction with
+		CPUID themselves and fall back to `int $0x30' without it. */
+	if (cpu_has_sysenter()) {
+		wrmsr(MSR_SYSENTER_CS, SEL_KCSEG);
+		wrmsr(MSR_SYSENTER_ESP, (uint32_t) tss_esp0_ptr());
+		wrmsr(MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+	}
 }
 
-static void syscall_handler(struct intr_frame* f UNUSED)
+/* Entry point from sysenter_entry(), which builds F to look
+	exactly like an `int $0x30' frame. */
+void syscall_sysenter(struct intr_frame* f)
 {
+	syscall_handler(f);
+}
 
-	if (!is_valid_buffer(f->esp, sizeof(int))) {
-		exit(-1);
-	}
+/* Kinds of system call arguments, which decide how each argument
+	is checked before the call runs. */
+enum syscall_arg {
+	ARG_INT, /* Integer or opaque value, passed through. */
+	ARG_PTR, /* User address that the call checks itself. */
+	ARG_STR, /* Null-terminated user string. */
+	ARG_BUF, /* User buffer, whose size is the next argument. */
+	ARG_LEN, /* Size of the preceding ARG_BUF. */
+	ARG_IOV, /* User array of struct iovec, whose length is next. */
+	ARG_CNT	/* Number of entries in the preceding ARG_IOV. */
+};
+
+/* Maximum number of arguments to a system call. */
+#define SYSCALL_MAX_ARGS 4
+
+/* A system call implementation, taking its arguments as words
+	already copied in from the user stack and checked according to
+	its descriptor.  The return value is stored in the caller's
+	EAX. */
+typedef uint32_t syscall_func(const uint32_t* argv);
+
+/* A system call descriptor. */
+struct syscall {
+	const char* name;									/* Name, for statistics. */
+	syscall_func* func;								/* Implementation. */
+	int arity;											/* Number of arguments. */
+	enum syscall_arg args[SYSCALL_MAX_ARGS]; /* Kind of each argument. */
+	unsigned long long calls;						/* Number of invocations. */
+	uint64_t cycles;									/* Time spent, in TSC cycles. */
+};
+
+static syscall_func sys_halt, sys_exit, sys_exec, sys_wait, sys_create,
+	 sys_sleep, sys_remove, sys_open, sys_filesize, sys_read, sys_write,
+	 sys_seek, sys_tell, sys_close, sys_getpid, sys_pread, sys_pwrite,
+	 sys_readv, sys_writev, sys_ioring_setup, sys_ioring_enter,
+	 sys_copy_file_range, sys_pipe, sys_sbrk;
+#ifdef VM
+static syscall_func sys_mmap, sys_munmap;
+#endif
+
+/* System call table, indexed by SYS_* number.  Calls without a
+	FUNC are not implemented and kill the caller. */
+static struct syscall syscalls[SYS_NUMBER_OF_CALLS] = {
+	[SYS_HALT] = {"halt", sys_halt, 0, {}},
+	[SYS_EXIT] = {"exit", sys_exit, 1, {ARG_INT}},
+	[SYS_EXEC] = {"exec", sys_exec, 1, {ARG_STR}},
+	[SYS_WAIT] = {"wait", sys_wait, 1, {ARG_INT}},
+	[SYS_CREATE] = {"create", sys_create, 2, {ARG_STR, ARG_INT}},
+	[SYS_SLEEP] = {"sleep", sys_sleep, 1, {ARG_INT}},
+	[SYS_REMOVE] = {"remove", sys_remove, 1, {ARG_STR}},
+	[SYS_OPEN] = {"open", sys_open, 1, {ARG_STR}},
+	[SYS_FILESIZE] = {"filesize", sys_filesize, 1, {ARG_INT}},
+	[SYS_READ] = {"read", sys_read, 3, {ARG_INT, ARG_BUF, ARG_LEN}},
+	[SYS_WRITE] = {"write", sys_write, 3, {ARG_INT, ARG_BUF, ARG_LEN}},
+	[SYS_SEEK] = {"seek", sys_seek, 2, {ARG_INT, ARG_INT}},
+	[SYS_TELL] = {"tell", sys_tell, 1, {ARG_INT}},
+	[SYS_CLOSE] = {"close", sys_close, 1, {ARG_INT}},
+#ifdef VM
+	[SYS_MMAP] = {"mmap", sys_mmap, 2, {ARG_INT, ARG_PTR}},
+	[SYS_MUNMAP] = {"munmap", sys_munmap, 1, {ARG_INT}},
+#else
+	[SYS_MMAP] = {"mmap", NULL, 2, {ARG_INT, ARG_PTR}},
+	[SYS_MUNMAP] = {"munmap", NULL, 1, {ARG_INT}},
+#endif
+	[SYS_CHDIR] = {"chdir", NULL, 1, {ARG_STR}},
+	[SYS_MKDIR] = {"mkdir", NULL, 1, {ARG_STR}},
+	[SYS_READDIR] = {"readdir", NULL, 2, {ARG_INT, ARG_PTR}},
+	[SYS_ISDIR] = {"isdir", NULL, 1, {ARG_INT}},
+	[SYS_INUMBER] = {"inumber", NULL, 1, {ARG_INT}},
+	[SYS_GETPID] = {"getpid", sys_getpid, 0, {}},
+	[SYS_PREAD] = {"pread", sys_pread, 4, {ARG_INT, ARG_BUF, ARG_LEN, ARG_INT}},
+	[SYS_PWRITE] = {"pwrite", sys_pwrite, 4, {ARG_INT, ARG_BUF, ARG_LEN, ARG_INT}},
+	[SYS_READV] = {"readv", sys_readv, 3, {ARG_INT, ARG_IOV, ARG_CNT}},
+	[SYS_WRITEV] = {"writev", sys_writev, 3, {ARG_INT, ARG_IOV, ARG_CNT}},
+	[SYS_IORING_SETUP] = {"ioring_setup", sys_ioring_setup, 2, {ARG_INT, ARG_PTR}},
+	[SYS_IORING_ENTER] = {"ioring_enter", sys_ioring_enter, 2, {ARG_INT, ARG_INT}},
+	[SYS_COPY_FILE_RANGE] = {"copy_file_range", sys_copy_file_range, 3, {ARG_INT, ARG_INT, ARG_INT}},
+	[SYS_PIPE] = {"pipe", sys_pipe, 1, {ARG_PTR}},
+	[SYS_SBRK] = {"sbrk", sys_sbrk, 1, {ARG_INT}},
+};
+
+/* If true, report per-call totals at shutdown.
+	Controlled by the kernel command-line option "-syscallstat". */
+bool syscall_stats_enabled;
+
+/* Frees the kernel copies of string and iovec arguments among the
+	first N arguments in ARGV, made by copy_in_args(). */
+static void release_args(const struct syscall* sc, uint32_t* argv, int n)
+{
+	int i;
 
-	switch (*(int*)f->esp) {
-		
-		case SYS_SLEEP:
-			int millis = *(int*)(f->esp + sizeof(int));
-			sleep(millis);
-			break;
-		
-		case SYS_HALT:
-			halt();
-			break;
-		
-		case SYS_CREATE: {
-			const char* file = *(char**)(f->esp + sizeof(char*));
-			unsigned initial_size = *(unsigned*) (f->esp + sizeof(char*) + sizeof(unsigned));
-			f->eax = create(file, initial_size);
-			}
-			break;
-		
-		case SYS_OPEN: {
-			const char* file = *(char**)(f->esp + sizeof(char*));
-			f->eax = open(file);
-			}
-			break;
-		
-		case SYS_CLOSE: {
+	for (i = 0; i < n; i++)
+		if (sc->args[i] == ARG_STR)
+			palloc_free_page((void*) argv[i]);
+		else if (sc->args[i] == ARG_IOV)
+			free((void*) argv[i]);
+}
 
-			// Validate the stack
-			if (!is_valid_buffer(f->esp + 4, sizeof(int))) {
-				exit(-1);
-			}
+/* Checks the CNT buffers in IOV, already copied into the kernel,
+	and merges each run of buffers that are adjacent in user memory
+	into one.  Returns the new number of buffers, or -1 if some
+	buffer is not in user memory.  Sets *TOTAL to the sum of the
+	lengths, saturating at UINT32_MAX. */
+static int import_iov(struct iovec* iov, int cnt, uint32_t* total)
+{
+	int i, n = 0;
+
+	*total = 0;
+	for (i = 0; i < cnt; i++) {
+		if (!user_range_ok(iov[i].iov_base, iov[i].iov_len))
+			return -1;
+		*total = iov[i].iov_len <= UINT32_MAX - *total ? *total + iov[i].iov_len : UINT32_MAX;
+		if (iov[i].iov_len == 0)
+			continue;
+		if (n > 0 && (uint8_t*) iov[n - 1].iov_base + iov[n - 1].iov_len == iov[i].iov_base)
+			iov[n - 1].iov_len += iov[i].iov_len;
+		else
+			iov[n++] = iov[i];
+	}
+	return n;
+}
 
-			int fd = *(int*)(f->esp + sizeof(int));
-			close(fd);
-			}
-			break;
-		
-		case SYS_WRITE: {
+/* Copies the arguments of the call described by SC from the user
+	stack at ESP into ARGV and checks each one according to its
+	kind.  Strings are copied into kernel pages, which replace the
+	user pointers in ARGV until release_args() frees them, so the
+	call never touches user memory for them.  Buffers are only
+	range-checked here; the call copies them in or out itself.
+	Vectors of buffers are copied into kernel memory and checked
+	once, the same way.  Kills the caller if an argument is bad.
+	Returns false if the call should fail without running, because
+	memory could not be allocated or a vector is too long. */
+static bool copy_in_args(const struct syscall* sc, const uint8_t* esp, uint32_t* argv)
+{
+	int i;
 
-			// Validate the stack
-			if (!is_valid_buffer(f->esp, 4 * sizeof(int))) {
-				exit(-1);
-			}
+	if (sc->arity > 0
+		 && !copy_from_user(argv, esp + sizeof(int), sc->arity * sizeof(uint32_t))) {
+		exit(-1);
+	}
 
-			int fd = *(int*)(f->esp + sizeof(int));
-			const void* buffer = *(void**)(f->esp + sizeof(int) + sizeof(void*));
-			unsigned size = *(unsigned*)(f->esp + sizeof(int) + sizeof(void*) + sizeof(unsigned));
-			f->eax = write(fd, buffer, size);
-			}
-			break;
-		
-		case SYS_READ: {
-			int fd = *(int*)(f->esp + sizeof(int));
-			void* buffer = *(void**)(f->esp + sizeof(int) + sizeof(void*));
-			unsigned size = *(unsigned*)(f->esp + sizeof(int) + sizeof(void*) + sizeof(unsigned));
-			f->eax = read(fd, buffer, size);
-			}
-			break;
-		
-		case SYS_REMOVE: {
-			const char* file_name = *(char**)(f->esp + sizeof(char*));
-			f->eax = remove(file_name);
-			}
-			break;
-		
-		case SYS_FILESIZE: {
-			int fd = *(int*)(f->esp + sizeof(int));
-			f->eax = filesize(fd);
-			}
-			break;
-		
-		case SYS_SEEK: {
-			int fd = *(int*)(f->esp + sizeof(int));
-			unsigned position = *(unsigned*)(f->esp + sizeof(int) + sizeof(unsigned));
-			seek(fd, position);
-			}
-			break;
-		
-		case SYS_TELL: {
-			int fd = *(int*)(f->esp + sizeof(int));
-			f->eax = tell(fd);
-			}
-			break;
-		
-		case SYS_EXIT: {
+	for (i = 0; i < sc->arity; i++) {
+		switch (sc->args[i]) {
+			case ARG_STR: {
+				char* kstr = palloc_get_page(0);
+				int len;
+
+				if (kstr == NULL) {
+					release_args(sc, argv, i);
+					return false;
+				}
+				len = strncpy_from_user(kstr, (const char*) argv[i], PGSIZE);
+				if (len < 0 || len == PGSIZE) {
+					palloc_free_page(kstr);
+					release_args(sc, argv, i);
+					exit(-1);
+				}
+				argv[i] = (uint32_t) kstr;
+				}
+				break;
+
+			case ARG_IOV: {
+				int cnt = (int) argv[i + 1];
+				struct iovec* kiov;
+				uint32_t total;
+
+				ASSERT(i + 1 < sc->arity && sc->args[i + 1] == ARG_CNT);
+				if (cnt < 0 || cnt > IOV_MAX) {
+					release_args(sc, argv, i);
+					return false;
+				}
+				kiov = malloc(cnt * sizeof *kiov);
+				if (cnt > 0 && kiov == NULL) {
+					release_args(sc, argv, i);
+					return false;
+				}
+				if (!copy_from_user(kiov, (const void*) argv[i], cnt * sizeof *kiov)
+					 || (cnt = import_iov(kiov, cnt, &total)) < 0) {
+					free(kiov);
+					release_args(sc, argv, i);
+					exit(-1);
+				}
+				if (total > INT_MAX) {
+					free(kiov);
+					release_args(sc, argv, i);
+					return false;
+				}
+				argv[i] = (uint32_t) kiov;
+				argv[i + 1] = cnt;
+				}
+				break;
+
+			case ARG_BUF:
+				ASSERT(i + 1 < sc->arity && sc->args[i + 1] == ARG_LEN);
+				if (!user_range_ok((const void*) argv[i], argv[i + 1])) {
+					release_args(sc, argv, i);
+					exit(-1);
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+	return true;
+}
 
-			// Make sure argument is a valid pointer
-			if (!is_valid_ptr(f->esp + sizeof(int))) {
-				exit(-1);
-			}
+static void syscall_handler(struct intr_frame* f)
+{
+	uint32_t argv[SYSCALL_MAX_ARGS];
+	struct thread* t = thread_current();
+	struct syscall* sc;
+	uint64_t start;
+	int nr;
+
+#ifdef VM
+	/* Lets faults on the user's stack during the call grow it. */
+	t->user_esp = f->esp;
+#endif
+
+	if (!copy_from_user(&nr, f->esp, sizeof nr)) {
+		exit(-1);
+	}
+	if (nr < 0 || nr >= SYS_NUMBER_OF_CALLS || syscalls[nr].func == NULL) {
+		exit(-1);
+	}
+	sc = &syscalls[nr];
 
-			int status = *(int*)(f->esp + sizeof(int));
-			exit(status);
-			}
-			break;
+	if (!copy_in_args(sc, f->esp, argv)) {
+		f->eax = -1;
+		return;
+	}
 
-		case SYS_EXEC: {
+	/* Count the call before running it, since exit() and halt()
+		do not return. */
+	if (syscall_stats_enabled) {
+		enum intr_level old_level = intr_disable();
+		sc->calls++;
+		intr_set_level(old_level);
+	}
 
-			// Validate the stack
-			if (!is_valid_buffer(f->esp, 2 * sizeof(int))) {
-				exit(-1);
-			}
+	/* A call that kills the process never returns here, so leave
+		its kernel copies where process_exit() can free them. */
+	t->syscall_nr = nr;
+	t->syscall_argv = argv;
+
+	start = syscall_stats_enabled ? rdtsc() : 0;
+	f->eax = sc->func(argv);
+	if (syscall_stats_enabled) {
+		uint64_t cycles = rdtsc() - start;
+		enum intr_level old_level = intr_disable();
+		sc->cycles += cycles;
+		intr_set_level(old_level);
+	}
 
-			// Get the argument pointer without dereferencing
-			char** cmd_line_ptr = (char**)(f->esp + sizeof(char*));
-			// Check if cmd_line_ptr itself is valid before dereferencing
-			if (!is_valid_ptr(cmd_line_ptr)) {
-				exit(-1);
-			}
+	t->syscall_argv = NULL;
+	release_args(sc, argv, sc->arity);
+}
 
-			const char* cmd_line = *(char**)(f->esp + sizeof(char*));
-			f->eax = exec(cmd_line);
-			}
-			break;
-		
-		case SYS_WAIT: {
-			int pid = *(int*)(f->esp + sizeof(int));
-			f->eax = wait(pid);
-			}
-			break;
-		
-		default: {
-			exit(-1);
-		}
-	}
+/* Frees the kernel copies of the arguments of the system call the
+	current process is dying in, if any. */
+void syscall_release_pending(void)
+{
+	struct thread* t = thread_current();
 
-	//thread_exit();
+	if (t->syscall_argv != NULL) {
+		const struct syscall* sc = &syscalls[t->syscall_nr];
+		release_args(sc, t->syscall_argv, sc->arity);
+		t->syscall_argv = NULL;
+	}
 }
 
-/* Validates if a pointer is below PHYS_BASE and in the current process' page table */
-bool is_valid_ptr(const void* ptr) {
-	if (ptr >= PHYS_BASE) {
-		return false;
+/* Prints per-call counts and cycles, busiest calls first. */
+void syscall_print_stats(void)
+{
+	static struct syscall* sorted[SYS_NUMBER_OF_CALLS];
+	size_t cnt = 0;
+	size_t i, j;
+
+	if (!syscall_stats_enabled)
+		return;
+
+	/* Insertion sort by descending total cycles. */
+	for (i = 0; i < SYS_NUMBER_OF_CALLS; i++) {
+		struct syscall* sc = &syscalls[i];
+		if (sc->calls == 0)
+			continue;
+		for (j = cnt; j > 0 && sorted[j - 1]->cycles < sc->cycles; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = sc;
+		cnt++;
 	}
 
-	// Validate the first page
-	if (pagedir_get_page(thread_current()->pagedir, ptr) == NULL) {
-		return false;
+	printf("Syscalls: %zu used, sorted by total cycles\n", cnt);
+	for (i = 0; i < cnt; i++) {
+		struct syscall* sc = sorted[i];
+		printf("  %-15s %llu calls, %llu cycles, %llu cycles/call\n",
+				 sc->name,
+				 sc->calls,
+				 sc->cycles,
+				 sc->cycles / sc->calls);
 	}
+}
+
+static uint32_t sys_halt(const uint32_t* argv UNUSED)
+{
+	halt();
+}
 
-	int length = sizeof(void*);
-	void* upper_bound = pg_round_up(ptr);
-	void* page;
+static uint32_t sys_exit(const uint32_t* argv)
+{
+	exit((int) argv[0]);
+}
 
-	// Validate the next pages
-	while ((ptr + length) > upper_bound) {
+static uint32_t sys_exec(const uint32_t* argv)
+{
+	return exec((const char*) argv[0]);
+}
 
-		// Make sure the next page is valid in pagedir
-		upper_bound++;
-		page = pagedir_get_page(thread_current()->pagedir, upper_bound);
-		if (page == NULL) {
-			return false;
-		}
+static uint32_t sys_wait(const uint32_t* argv)
+{
+	return wait((int) argv[0]);
+}
+
+static uint32_t sys_create(const uint32_t* argv)
+{
+	return create((const char*) argv[0], argv[1]);
+}
+
+static uint32_t sys_sleep(const uint32_t* argv)
+{
+	sleep((int) argv[0]);
+	return 0;
+}
+
+static uint32_t sys_remove(const uint32_t* argv)
+{
+	return remove((const char*) argv[0]);
+}
+
+static uint32_t sys_open(const uint32_t* argv)
+{
+	return open((const char*) argv[0]);
+}
+
+static uint32_t sys_filesize(const uint32_t* argv)
+{
+	return filesize((int) argv[0]);
+}
+
+static uint32_t sys_read(const uint32_t* argv)
+{
+	return read((int) argv[0], (void*) argv[1], argv[2]);
+}
+
+static uint32_t sys_write(const uint32_t* argv)
+{
+	return write((int) argv[0], (const void*) argv[1], argv[2]);
+}
+
+static uint32_t sys_seek(const uint32_t* argv)
+{
+	seek((int) argv[0], argv[1]);
+	return 0;
+}
+
+static uint32_t sys_tell(const uint32_t* argv)
+{
+	return tell((int) argv[0]);
+}
+
+static uint32_t sys_close(const uint32_t* argv)
+{
+	close((int) argv[0]);
+	return 0;
+}
+
+static uint32_t sys_getpid(const uint32_t* argv UNUSED)
+{
+	return getpid();
+}
+
+static uint32_t sys_pread(const uint32_t* argv)
+{
+	return pread((int) argv[0], (void*) argv[1], argv[2], argv[3]);
+}
+
+static uint32_t sys_pwrite(const uint32_t* argv)
+{
+	return pwrite((int) argv[0], (const void*) argv[1], argv[2], argv[3]);
+}
+
+static uint32_t sys_readv(const uint32_t* argv)
+{
+	return readv((int) argv[0], (const struct iovec*) argv[1], argv[2]);
+}
+
+static uint32_t sys_writev(const uint32_t* argv)
+{
+	return writev((int) argv[0], (const struct iovec*) argv[1], argv[2]);
+}
+
+static uint32_t sys_ioring_setup(const uint32_t* argv)
+{
+	return ioring_setup(argv[0], (void*) argv[1]);
+}
 
-		// Upper bound is valid page in the pagedir, update upper bound
-		upper_bound = pg_round_up(page);
+static uint32_t sys_ioring_enter(const uint32_t* argv)
+{
+	return ioring_enter(argv[0], argv[1]);
+}
+
+static uint32_t sys_copy_file_range(const uint32_t* argv)
+{
+	return copy_file_range((int) argv[0], (int) argv[1], argv[2]);
+}
+
+static uint32_t sys_pipe(const uint32_t* argv)
+{
+	return pipe((int*) argv[0]);
+}
+
+static uint32_t sys_sbrk(const uint32_t* argv)
+{
+	return (uint32_t) sbrk((int) argv[0]);
+}
+
+#ifdef VM
+static uint32_t sys_mmap(const uint32_t* argv)
+{
+	return mmap((int) argv[0], (void*) argv[1]);
+}
+
+static uint32_t sys_munmap(const uint32_t* argv)
+{
+	munmap((mapid_t) argv[0]);
+	return 0;
+}
+#endif
+
+/* Size of the on-stack bounce buffer used for short transfers. */
+#define BOUNCE_SMALL 256
+
+/* Kernel buffer through which read() and write() move data
+	between user memory and a file or the console.  Copying through
+	it means faults on user memory are taken here, with no file
+	system locks held, rather than deep inside the file system. */
+struct bounce {
+	uint8_t* data;						/* Buffer in use. */
+	size_t size;						/* Capacity of DATA. */
+	uint8_t small[BOUNCE_SMALL];	/* Used for short transfers. */
+};
+
+/* Sets up B for a transfer of LENGTH bytes.  Long transfers get a
+	whole page, short ones (or all of them, if no page is free)
+	use the buffer inside B. */
+static void bounce_init(struct bounce* b, size_t length)
+{
+	b->data = length > BOUNCE_SMALL ? palloc_get_page(0) : NULL;
+	b->size = PGSIZE;
+	if (b->data == NULL) {
+		b->data = b->small;
+		b->size = BOUNCE_SMALL;
 	}
+}
 
-	// If we get here, we know all the pages the string spans over are valid
-	return true;
+/* Releases B's page, if it has one. */
+static void bounce_destroy(struct bounce* b)
+{
+	if (b->data != b->small)
+		palloc_free_page(b->data);
 }
 
-/* Validates if a string has a terminator character */
-bool is_valid_string(const char* s) {
-	
-	bool valid_ptr = is_valid_ptr(s);
-	if (!valid_ptr) return false;
-
-	// Find out the length of the string
-	int length = strlen(s);
-
-	// Find the end of the page
-	void* upper_bound = pg_round_up(s);
-	void* page;
-
-	// Loop while string might be out of the page, but still in a valid page
-	while ((void*)(s + (length * sizeof(char))) > upper_bound) {
-		
-		// Make sure the next page is valid in pagedir
-		upper_bound++;
-		page = pagedir_get_page(thread_current()->pagedir, upper_bound);
-		if (page == NULL) {
+/* Position within a vector of user buffers. */
+struct iov_cursor {
+	const struct iovec* iov; /* Next buffer. */
+	size_t ofs;					 /* Offset within *IOV. */
+};
+
+/* Copies SIZE bytes between kernel buffer KBUF and the user
+	buffers at cursor C, advancing C: from the user buffers into
+	KBUF if TO_KERNEL, otherwise the other way.  Returns false if a
+	user buffer is not mapped. */
+static bool iov_copy(struct iov_cursor* c, uint8_t* kbuf, size_t size, bool to_kernel)
+{
+	while (size > 0) {
+		size_t left = c->iov->iov_len - c->ofs;
+		size_t n = size < left ? size : left;
+		uint8_t* ubuf = (uint8_t*) c->iov->iov_base + c->ofs;
+
+		if (!(to_kernel ? copy_from_user(kbuf, ubuf, n) : copy_to_user(ubuf, kbuf, n)))
 			return false;
+		kbuf += n;
+		size -= n;
+		c->ofs += n;
+		if (c->ofs == c->iov->iov_len) {
+			c->iov++;
+			c->ofs = 0;
 		}
-
-		// Upper bound is a valid page in the pagedir, update the upper_bound
-		upper_bound = pg_round_up(page);
 	}
-
-	// If we get here, we know all the pages the string spans over are valid
 	return true;
 }
 
-bool is_valid_buffer(const void* buffer, unsigned length) {
-
-	bool valid_ptr = is_valid_ptr(buffer);
-	if(!valid_ptr) return false;
+/* Moves data between the CNT user buffers in IOV, which together
+	hold TOTAL bytes, and file F: from F into the buffers if
+	WRITING is false, otherwise from the buffers into F, or to the
+	console if F is a null pointer.  If OFS is nonnegative the
+	transfer starts at that offset in F and the file position is
+	left alone; otherwise it starts at, and advances, the file
+	position.
+
+	Data is gathered into (or scattered from) a bounce buffer so
+	that each chunk, however many user buffers it spans, is a
+	single file system operation.  Kills the process if a user
+	buffer is not mapped.  Returns the number of bytes moved. */
+static int transfer(struct file* f, const struct iovec* iov, int cnt, size_t total,
+						  off_t ofs, bool writing)
+{
+	struct iov_cursor c = {iov, 0};
+	struct bounce b;
+	size_t done = 0;
 
-	// Find out how long the buffer is
-	unsigned size = length * sizeof(char);
+	ASSERT(f != NULL || writing);
+	ASSERT(cnt > 0 || total == 0);
 
-	void* upper_bound = pg_round_up(buffer); 
-	void* page;
+	bounce_init(&b, total);
+	while (done < total) {
+		size_t chunk = total - done < b.size ? total - done : b.size;
+		size_t moved;
 
-	// Loop while buffer might be out of the page, but still in a valid page
-	while ((void*)(buffer + size) > upper_bound) {
-		
-		// Make sure next page is valid in the pagedir
-		upper_bound++;
-		page = pagedir_get_page(thread_current()->pagedir, upper_bound);
-		if (page == NULL) {
-			return false;
+		if (writing) {
+			if (!iov_copy(&c, b.data, chunk, true)) {
+				bounce_destroy(&b);
+				exit(-1);
+			}
+			if (f == NULL) {
+				putbuf((const char*) b.data, chunk);
+				moved = chunk;
+			} else if (ofs >= 0) {
+				moved = file_write_at(f, b.data, chunk, ofs + done);
+			} else {
+				moved = file_write(f, b.data, chunk);
+			}
+		} else {
+			if (ofs >= 0) {
+				moved = file_read_at(f, b.data, chunk, ofs + done);
+			} else {
+				moved = file_read(f, b.data, chunk);
+			}
+			if (!iov_copy(&c, b.data, moved, false)) {
+				bounce_destroy(&b);
+				exit(-1);
+			}
 		}
+		done += moved;
 
-		// Upper bound is a valid page in the pagedir, update the upper_bound
-		upper_bound = pg_round_up(page);
+		// Stop at end of file
+		if (moved < chunk) {
+			break;
+		}
 	}
 
-	// If we get here, we know all the pages the buffer spans over are valid
-	return true;
+	bounce_destroy(&b);
+	return done;
+}
+
+/* Returns the total length of the CNT buffers in IOV. */
+static size_t iov_total(const struct iovec* iov, int cnt)
+{
+	size_t total = 0;
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		total += iov[i].iov_len;
+	return total;
 }
 
 bool is_valid_fd(int fd) {
-	bool result = 2 <= fd && fd <= 129;
+	bool result = FD_FIRST <= fd && (size_t) (fd - FD_FIRST) < fd_limit;
 	return result;
 }
 
+/* Returns the file open as FD in the current process, or a null
+	pointer if FD is not open or is a pipe.  Kills the process if FD
+	could never be valid. */
+static struct file* lookup_fd(int fd) {
+	if (!is_valid_fd(fd)) {
+		exit(-1);
+	}
+	return fd_lookup(&thread_current()->fds, fd);
+}
+
 void sleep(int millis) {
 	timer_msleep(millis);
 }
@@ -278,11 +673,6 @@ void halt(void) {
 
 bool create(const char* file, unsigned initial_size) {
 
-	// Validate the input
-	if (!is_valid_string(file)) {
-		exit(-1);
-	}
-
 	// Handle invalid inputs
 	if (file == NULL) {
 		return false;
@@ -295,37 +685,22 @@ bool create(const char* file, unsigned initial_size) {
 
 int open(const char* file) {
 
-	// Validate the string
-	if (!is_valid_string(file)) {
-		exit(-1);
-	}
-
 	struct thread* thread = thread_current();
 
 	// Open the file from filesys
 	struct file* f = filesys_open(file);
 
 	// Assure the file exists
-	if (f) {
-		
-		// Find a null item
-		for (int i = 0; i < MAX_FILES; i++) {
-			if (thread->OPEN_FILES[i] == NULL) {
-
-				// Add file to array
-				thread->OPEN_FILES[i] = f;
-
-				// Return an offset value to account for fd 0 and 1 (STDIN / STDOUT)
-				return i + 2;
-
-			}
-		}
+	if (f == NULL) {
+		return -1;
 	}
 
-	// Else return -1
-	return -1;
-
-	
+	// Install it in the lowest free descriptor
+	int fd = fd_alloc(&thread->fds, f);
+	if (fd < 0) {
+		file_close(f);
+	}
+	return fd;
 }
 
 
@@ -336,71 +711,66 @@ void close(int fd) {
 		exit(-1);
 	}
 
-	struct thread* thread = thread_current();
-
-	// re-offset the fd value to get the right index
-	fd -= 2;
+	// Remove it from the table and close it, if it was open
+	fd_close(&thread_current()->fds, fd);
+}
 
-	// Retrieve the pointer to the file
-	struct file* f = thread->OPEN_FILES[fd];
 
-	// Close it
-	file_close(f);
+int write(int fd, const void* buffer, unsigned size) {
 
-	// Mark file in array as NULL
-	thread->OPEN_FILES[fd] = NULL; 
-	
+	struct iovec iov = {(void*) buffer, size};
+	return writev(fd, &iov, 1);
 }
 
 
-int write(int fd, const void* buffer, unsigned size) {
-
-	// Check if buffer is valid
-	if(!is_valid_buffer(buffer, size)) {
-		exit(-1);
-	}
-	
-	struct thread* thread = thread_current();
+int read(int fd, void* buffer, unsigned size) {
 
-	// We get in here if we want to write to the standard output
-	if (fd == 1) {
-		putbuf((const char*) buffer, size);
-		return size;
+	if (fd == 0) {
+		int bytes_read = read_from_stdin((char*) buffer, size);
+		return bytes_read;
 	}
 
-	// Validate the fd after stdout call
-	if (!is_valid_fd(fd)) {
-		exit(-1);
-	}
+	struct iovec iov = {buffer, size};
+	return readv(fd, &iov, 1);
+}
 
-	// Here we are sure we want to write to a file
-	// Get the file pointer
-	struct file* f = thread->OPEN_FILES[fd - 2];
+int pread(int fd, void* buffer, unsigned size, unsigned offset) {
 
-	// If the file exists, write to it
-	if (f) {
-		int bytes_written = (int) file_write(f, buffer, size);
-		return bytes_written;
+	// Only files have offsets
+	struct file* f = fd >= FD_FIRST ? lookup_fd(fd) : NULL;
+	if (f == NULL || offset > INT_MAX) {
+		return -1;
 	}
 
-	// If file does not exist, return -1
-	return -1;
-
+	struct iovec iov = {buffer, size};
+	return transfer(f, &iov, 1, size, offset, false);
 }
 
+int pwrite(int fd, const void* buffer, unsigned size, unsigned offset) {
 
-int read(int fd, void* buffer, unsigned size) {
-
-	// Check if buffer is valid
-	if(!is_valid_buffer(buffer, size)) {
-		exit(-1);
+	// Only files have offsets
+	struct file* f = fd >= FD_FIRST ? lookup_fd(fd) : NULL;
+	if (f == NULL || offset > INT_MAX) {
+		return -1;
 	}
 
-	struct thread* thread = thread_current();
+	struct iovec iov = {(void*) buffer, size};
+	return transfer(f, &iov, 1, size, offset, true);
+}
+
+int readv(int fd, const struct iovec* iov, int iovcnt) {
 
+	// Read the console one buffer at a time
 	if (fd == 0) {
-		int bytes_read = read_from_stdin((char*) buffer, size);
-		return bytes_read;
+		int done = 0;
+		for (int i = 0; i < iovcnt; i++) {
+			int n = read_from_stdin(iov[i].iov_base, iov[i].iov_len);
+			done += n;
+			if ((unsigned) n < iov[i].iov_len) {
+				break;
+			}
+		}
+		return done;
 	}
 
 	// Deny reading from STDOUT
@@ -408,34 +778,92 @@ int read(int fd, void* buffer, unsigned size) {
 		return -1;
 	}
 
-	// Validate the fd
-	if (!is_valid_fd(fd)) {
-		exit(-1);
+	// Pipes hand out what they have, waiting only for the first byte
+	bool write_end;
+	struct pipe* p = fd_lookup_pipe(&thread_current()->fds, fd, &write_end);
+	if (p != NULL) {
+		if (write_end) {
+			return -1;
+		}
+		int done = 0;
+		for (int i = 0; i < iovcnt; i++) {
+			int n = pipe_read(p, iov[i].iov_base, iov[i].iov_len, i == 0);
+			done += n;
+			if ((size_t) n < iov[i].iov_len) {
+				break;
+			}
+		}
+		return done;
 	}
 
 	// Check if file is closed
 	// If so, return -1
-	else if (thread->OPEN_FILES[fd - 2] == NULL) {
+	struct file* f = lookup_fd(fd);
+	if (f == NULL) {
 		return -1;
 	}
 
-	struct file* f = thread->OPEN_FILES[fd - 2];
+	return transfer(f, iov, iovcnt, iov_total(iov, iovcnt), -1, false);
+}
+
+int writev(int fd, const struct iovec* iov, int iovcnt) {
 
-	int bytes_read = file_read(f, buffer, size);
-	return bytes_read;
+	struct file* f = NULL;
+
+	// Pipes take each buffer whole, unless the readers go away
+	bool write_end;
+	struct pipe* p = fd_lookup_pipe(&thread_current()->fds, fd, &write_end);
+	if (p != NULL) {
+		if (!write_end) {
+			return -1;
+		}
+		int done = 0;
+		for (int i = 0; i < iovcnt; i++) {
+			int n = pipe_write(p, iov[i].iov_base, iov[i].iov_len);
+			if (n < 0) {
+				return done > 0 ? done : -1;
+			}
+			done += n;
+			if ((size_t) n < iov[i].iov_len) {
+				break;
+			}
+		}
+		return done;
+	}
+
+	// Anything but the standard output must be an open file
+	if (fd != 1) {
+		f = lookup_fd(fd);
+		if (f == NULL) {
+			return -1;
+		}
+	}
 
+	return transfer(f, iov, iovcnt, iov_total(iov, iovcnt), -1, true);
 }
 
+/* Reads keyboard input into BUFFER, echoing it, until SIZE bytes
+	have been read or a line has ended, so that buffered readers
+	see each line as soon as it is entered.  Returns the number of
+	bytes read. */
 int read_from_stdin(char* buffer, int size) {
 	
 	for (int i = 0; i < size; i++) {
-		buffer[i] = input_getc();
+		char c = input_getc();
 
 		// Replace \r with \n
-		if (buffer[i] == '\r') {
-			buffer[i] = '\n';
+		if (c == '\r') {
+			c = '\n';
+		}
+		if (!put_user_byte((uint8_t*) &buffer[i], c)) {
+			exit(-1);
+		}
+		putbuf(&c, 1);
+
+		// A line is as much as a reader gets at once
+		if (c == '\n') {
+			return i + 1;
 		}
-		write(1, &(buffer[i]), 1);
 	}
 	
 	return size;
@@ -444,11 +872,6 @@ int read_from_stdin(char* buffer, int size) {
 
 bool remove(const char* file_name) {
 
-	// Validate the string
-	if (!is_valid_string(file_name)) {
-		exit(-1);
-	}
-
 	bool success = filesys_remove(file_name);
 	return success;
 }
@@ -457,13 +880,14 @@ bool remove(const char* file_name) {
 int filesize(int fd) {
 
 	// Validate the fd
-	if (!is_valid_fd(fd)) {
+	struct file* f = lookup_fd(fd);
+	if (f == NULL) {
+		// Pipes have no size or position
+		if (fd_is_open(&thread_current()->fds, fd)) {
+			return -1;
+		}
 		exit(-1);
 	}
-
-	struct thread* thread = thread_current();
-
-	struct file* f = thread->OPEN_FILES[fd - 2];
 	int size = file_length(f);
 	return size;
 }
@@ -472,13 +896,14 @@ int filesize(int fd) {
 void seek(int fd, unsigned position) {
 
 	// Validate the fd
-	if (!is_valid_fd(fd)) {
+	struct file* f = lookup_fd(fd);
+	if (f == NULL) {
+		// Pipes have no size or position
+		if (fd_is_open(&thread_current()->fds, fd)) {
+			return;
+		}
 		exit(-1);
 	}
-
-	struct thread* thread = thread_current();
-
-	struct file* f = thread->OPEN_FILES[fd - 2];
 	unsigned size = file_length(f);
 
 	// If the position is larger than the file size (position would be out of file)
@@ -492,14 +917,15 @@ void seek(int fd, unsigned position) {
 unsigned tell(int fd) {
 
 	// Validate the fd
-	if (!is_valid_fd(fd)) {
+	struct file* f = lookup_fd(fd);
+	if (f == NULL) {
+		// Pipes have no size or position
+		if (fd_is_open(&thread_current()->fds, fd)) {
+			return 0;
+		}
 		exit(-1);
 	}
 
-	struct thread* thread = thread_current();
-
-	struct file* f = thread->OPEN_FILES[fd - 2];
-
 	unsigned offset = file_tell(f);
 	return offset;
 }
@@ -515,11 +941,6 @@ void exit(int status) {
 }
 
 pid_t exec(const char* cmd_line) {
-
-	// Validate the string
-	if (!is_valid_string(cmd_line)) {
-		exit(-1);
-	}
 	tid_t tid = process_execute(cmd_line);
 	return tid;
 }
@@ -528,4 +949,69 @@ int wait(int pid) {
 	return process_wait(pid);
 }
 
+pid_t getpid(void) {
+	return thread_current()->tid;
+}
 
+int copy_file_range(int fd_in, int fd_out, unsigned length) {
+
+	// Both ends must be open files, not the console
+	struct file* in = fd_in >= FD_FIRST ? lookup_fd(fd_in) : NULL;
+	struct file* out = fd_out >= FD_FIRST ? lookup_fd(fd_out) : NULL;
+	if (in == NULL || out == NULL || length > INT_MAX) {
+		return -1;
+	}
+
+	return file_copy(out, in, length);
+}
+
+int pipe(int fds[2]) {
+
+	struct thread* thread = thread_current();
+
+	struct pipe* p = pipe_create();
+	if (p == NULL) {
+		return -1;
+	}
+
+	// Give each end its own descriptor
+	int ends[2];
+	ends[0] = fd_install(&thread->fds, FD_PIPE_READ, p);
+	if (ends[0] < 0) {
+		pipe_close(p, false);
+		pipe_close(p, true);
+		return -1;
+	}
+	ends[1] = fd_install(&thread->fds, FD_PIPE_WRITE, p);
+	if (ends[1] < 0) {
+		fd_close(&thread->fds, ends[0]);
+		pipe_close(p, true);
+		return -1;
+	}
+
+	if (!copy_to_user(fds, ends, sizeof ends)) {
+		exit(-1);
+	}
+	return 0;
+}
+
+void* sbrk(int increment) {
+	return process_sbrk(increment);
+}
+
+#ifdef VM
+mapid_t mmap(int fd, void* addr) {
+
+	// Only files can be mapped
+	struct file* f = fd >= FD_FIRST ? lookup_fd(fd) : NULL;
+	if (f == NULL) {
+		return MAP_FAILED;
+	}
+
+	return mmap_map(f, addr);
+}
+
+void munmap(mapid_t mapping) {
+	mmap_unmap(mapping);
+}
+#endif
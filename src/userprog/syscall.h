@@ -4,7 +4,11 @@
 #include <stdbool.h>
 #include <user/syscall.h>
 
+extern bool syscall_stats_enabled;
+
 void syscall_init(void);
+void syscall_print_stats(void);
+void syscall_release_pending(void);
 
 void sleep(int millis);
 void halt(void);
@@ -20,5 +24,17 @@ unsigned tell(int fd);
 void exit(int status);
 pid_t exec(const char* cmd_line);
 int wait(int pid);
+pid_t getpid(void);
+int pread(int fd, void* buffer, unsigned size, unsigned offset);
+int pwrite(int fd, const void* buffer, unsigned size, unsigned offset);
+int readv(int fd, const struct iovec* iov, int iovcnt);
+int writev(int fd, const struct iovec* iov, int iovcnt);
+int copy_file_range(int fd_in, int fd_out, unsigned length);
+int pipe(int fds[2]);
+void* sbrk(int increment);
+#ifdef VM
+mapid_t mmap(int fd, void* addr);
+void munmap(mapid_t mapping);
+#endif
 
 #endif /* userprog/syscall.h */
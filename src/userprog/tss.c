@@ -102,3 +102,12 @@ void tss_update(void)
 	ASSERT(tss != NULL);
 	tss->esp0 = (uint8_t*) thread_current() + PGSIZE;
 }
+
+/* Returns the address of the ring 0 stack pointer in the TSS.
+	The SYSENTER path loads its stack from here, since the CPU
+	does not do that for it (see userprog/sysenter.S). */
+void** tss_esp0_ptr(void)
+{
+	ASSERT(tss != NULL);
+	return &tss->esp0;
+}
@@ -0,0 +1,155 @@
+#include "userprog/uaccess.h"
+
+#include "threads/vaddr.h"
+
+#include <debug.h>
+
+/* Access to user memory from the kernel.
+
+	Rather than walking the page directory to decide in advance
+	whether a user address is mapped, these routines simply touch
+	it.  Each instruction that may fault on a user address has an
+	entry in the exception table, the __ex_table section gathered
+	by the kernel linker script, naming the instruction and the
+	address to resume at.  When the page fault handler sees a
+	kernel-mode fault on one of those instructions, it changes the
+	saved EIP to the resume address instead of panicking, and the
+	routine reports the failure.  The common case, a valid
+	address, then costs nothing beyond the copy itself.
+
+	Callers must still reject kernel addresses, which would not
+	fault; user_range_ok() does that. */
+
+/* One exception table entry. */
+struct ex_entry {
+	uint32_t insn;	/* Address of an instruction that may fault. */
+	uint32_t fixup; /* Address to resume at if it does. */
+};
+
+/* Bounds of the exception table, from the linker script. */
+extern const struct ex_entry __start_ex_table[], __stop_ex_table[];
+
+/* Returns true if the SIZE bytes starting at UADDR lie entirely
+	in user virtual memory.  Says nothing about whether they are
+	mapped. */
+bool user_range_ok(const void* uaddr, size_t size)
+{
+	return is_user_vaddr(uaddr) && size <= (uintptr_t) PHYS_BASE - (uintptr_t) uaddr;
+}
+
+/* Copies SIZE bytes from SRC to DST, either of which may be a
+	user address.  Returns the number of bytes not copied: zero on
+	success, nonzero if a page fault stopped the copy. */
+static size_t copy_raw(void* dst, const void* src, size_t size)
+{
+	size_t words = size / sizeof(uint32_t);
+	size_t bytes = size % sizeof(uint32_t);
+
+	asm volatile(
+		 "1: rep movsl\n"
+		 "   movl %[bytes], %%ecx\n"
+		 "2: rep movsb\n"
+		 "3:\n"
+		 ".section __ex_table, \"a\"\n"
+		 "   .long 1b, 3b\n"
+		 "   .long 2b, 3b\n"
+		 ".previous\n"
+		 : "+D"(dst), "+S"(src), "+c"(words)
+		 : [bytes] "r"(bytes)
+		 : "memory");
+	return words;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address DST.
+	Returns true if successful, false if any part of the source is
+	outside user memory or unmapped. */
+bool copy_from_user(void* dst, const void* usrc, size_t size)
+{
+	return user_range_ok(usrc, size) && copy_raw(dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address UDST.
+	Returns true if successful, false if any part of the
+	destination is outside user memory or unmapped. */
+bool copy_to_user(void* udst, const void* src, size_t size)
+{
+	return user_range_ok(udst, size) && copy_raw(udst, src, size) == 0;
+}
+
+/* Reads the byte at user address USRC into *DST.
+	Returns true if successful, false on a bad address. */
+bool get_user_byte(uint8_t* dst, const uint8_t* usrc)
+{
+	int error;
+	uint8_t byte;
+
+	if (!is_user_vaddr(usrc))
+		return false;
+	asm volatile(
+		 "   movl $1, %0\n"
+		 "1: movb %2, %1\n"
+		 "   xorl %0, %0\n"
+		 "2:\n"
+		 ".section __ex_table, \"a\"\n"
+		 "   .long 1b, 2b\n"
+		 ".previous\n"
+		 : "=&r"(error), "=q"(byte)
+		 : "m"(*usrc));
+	if (error)
+		return false;
+	*dst = byte;
+	return true;
+}
+
+/* Writes BYTE to user address UDST.
+	Returns true if successful, false on a bad address. */
+bool put_user_byte(uint8_t* udst, uint8_t byte)
+{
+	int error;
+
+	if (!is_user_vaddr(udst))
+		return false;
+	asm volatile(
+		 "   movl $1, %0\n"
+		 "1: movb %b2, %1\n"
+		 "   xorl %0, %0\n"
+		 "2:\n"
+		 ".section __ex_table, \"a\"\n"
+		 "   .long 1b, 2b\n"
+		 ".previous\n"
+		 : "=&r"(error), "=m"(*udst)
+		 : "q"(byte));
+	return error == 0;
+}
+
+/* Copies a null-terminated string from user address USRC into
+	the SIZE-byte kernel buffer DST.  Returns the string's length,
+	not counting the null terminator, if it fit; SIZE if it did
+	not, in which case DST is not null-terminated; or -1 on a bad
+	address. */
+int strncpy_from_user(char* dst, const char* usrc, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		if (!get_user_byte((uint8_t*) &dst[i], (const uint8_t*) &usrc[i]))
+			return -1;
+		if (dst[i] == '\0')
+			return i;
+	}
+	return size;
+}
+
+/* If EIP is an instruction listed in the exception table, returns
+	the address to resume at after a fault there; otherwise
+	returns 0.  The table has only a handful of entries, so a
+	linear search is fine. */
+uint32_t uaccess_fixup(uint32_t eip)
+{
+	const struct ex_entry* e;
+
+	for (e = __start_ex_table; e < __stop_ex_table; e++)
+		if (e->insn == eip)
+			return e->fixup;
+	return 0;
+}
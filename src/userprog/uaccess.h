@@ -0,0 +1,17 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+bool user_range_ok(const void* uaddr, size_t size);
+bool copy_from_user(void* dst, const void* usrc, size_t size);
+bool copy_to_user(void* udst, const void* src, size_t size);
+int strncpy_from_user(char* dst, const char* usrc, size_t size);
+bool get_user_byte(uint8_t* dst, const uint8_t* usrc);
+bool put_user_byte(uint8_t* udst, uint8_t byte);
+
+uint32_t uaccess_fixup(uint32_t eip);
+
+#endif /* userprog/uaccess.h */
@@ -0,0 +1,435 @@
+#include "vm/frame.h"
+
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+#include <debug.h>
+
+/* The frame table.
+
+	Every frame in the user pool that holds a user page is on
+	FRAMES, in allocation order.  When the pool runs dry, the clock
+	hand sweeps the list looking for a page to push out: a page
+	that was accessed since the hand last passed gets its accessed
+	bit cleared and a second chance; one that was not, and is
+	clean, can be dropped, since reading it back from its file or
+	zeroing it again recreates it.  A dirty page of a memory-mapped
+	file is written back to the file.  Other dirty pages have to go
+	to swap.  The hand gathers up to SWAP_BATCH of them and writes
+	them out together, keeping one frame and returning the rest to
+	the pool for the allocations that are sure to follow.
+
+	Read-only pages of executables are shared: the text cache maps
+	each (inode, offset) that some process has resident to its
+	frame, and every other process running the same executable
+	maps that frame too.  A shared frame counts as accessed if any
+	of its pages was, and eviction unmaps it everywhere at once.
+	Cached text never goes stale: every process mapping a shared
+	frame keeps its executable open with writes denied, and the
+	frame leaves the cache before the last such process is gone.
+
+	Zero-fill pages that have only been read all map the zero
+	frame, read-only.  It is not on FRAMES, so it is never evicted
+	or freed; a page gets a frame of its own on its first write.
+
+	The page table code calls in here with the VM lock held, which
+	also protects the frame table and the text cache.  Eviction
+	drops the lock while it writes pages out, after unmapping them,
+	marking them busy and pinning their frames, so that other
+	evictions pass those frames by. */
+static struct list frames;
+
+/* Next frame the clock hand considers, or the list end. */
+static struct list_elem* hand;
+
+/* Number of pinned frames. */
+static size_t pinned_cnt;
+
+/* Shared text frames, keyed by inode and offset. */
+static struct hash text_cache;
+
+/* A page of zeroes shared by every zero-fill page not yet
+	written. */
+static struct frame zero_frame;
+
+static hash_hash_func cache_hash;
+static hash_less_func cache_less;
+
+/* Initializes the frame table. */
+void frame_init(void)
+{
+	list_init(&frames);
+	hand = list_end(&frames);
+	if (!hash_init(&text_cache, cache_hash, cache_less, NULL))
+		PANIC("frame: text cache creation failed");
+
+	zero_frame.kpage = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	zero_frame.shared = false;
+	zero_frame.pinned = false;
+	list_init(&zero_frame.pages);
+}
+
+/* Keeps evictions away from F, which is being filled or written
+	out without the VM lock. */
+void frame_pin(struct frame* f)
+{
+	ASSERT(!f->pinned);
+	f->pinned = true;
+	pinned_cnt++;
+}
+
+/* Undoes frame_pin(). */
+void frame_unpin(struct frame* f)
+{
+	ASSERT(f->pinned);
+	f->pinned = false;
+	pinned_cnt--;
+}
+
+/* Returns the zero frame, which zero-fill pages map read-only
+	until they are first written. */
+struct frame* frame_zero(void)
+{
+	return &zero_frame;
+}
+
+/* Moves the clock hand to the next frame, wrapping around. */
+static struct frame* advance_hand(void)
+{
+	if (hand == list_end(&frames))
+		hand = list_begin(&frames);
+	else
+		hand = list_next(hand);
+	if (hand == list_end(&frames))
+		hand = list_begin(&frames);
+	return list_entry(hand, struct frame, elem);
+}
+
+/* Returns the page that F holds, which must be F's only page. */
+static struct page* sole_page(struct frame* f)
+{
+	ASSERT(list_size(&f->pages) == 1);
+	return list_entry(list_front(&f->pages), struct page, frame_elem);
+}
+
+/* Detaches every page from F, which must already be unmapped
+	everywhere, and takes F out of the text cache. */
+static void detach_all(struct frame* f)
+{
+	while (!list_empty(&f->pages)) {
+		struct page* p = list_entry(list_pop_front(&f->pages), struct page, frame_elem);
+		p->frame = NULL;
+	}
+	if (f->shared) {
+		hash_delete(&text_cache, &f->cache_elem);
+		f->shared = false;
+	}
+}
+
+/* Removes F from the frame table and frees it.  F must hold no
+	pages. */
+static void discard(struct frame* f)
+{
+	ASSERT(list_empty(&f->pages));
+
+	if (hand == &f->elem)
+		hand = list_prev(hand);
+	list_remove(&f->elem);
+	palloc_free_page(f->kpage);
+	free(f);
+}
+
+/* Returns true if F is among the CNT frames in BATCH. */
+static bool in_batch(struct frame* const batch[], size_t cnt, struct frame* f)
+{
+	size_t i;
+
+	for (i = 0; i < cnt; i++)
+		if (batch[i] == f)
+			return true;
+	return false;
+}
+
+/* Pins F, whose only page is unmapped, for I/O without the VM
+	lock: marks the page busy, so that faults on it and its removal
+	wait, and keeps other evictions away from F. */
+static void pin(struct frame* f)
+{
+	sole_page(f)->busy = true;
+	frame_pin(f);
+}
+
+/* Undoes pin() for F, whose page was P. */
+static void unpin(struct frame* f, struct page* p)
+{
+	frame_unpin(f);
+	page_unbusy(p);
+}
+
+/* Writes the CNT dirty frames in BATCH to swap and unmaps their
+	pages.  Returns one of the frames for reuse and frees the
+	others, or returns a null pointer if swap is full.  Frames
+	that did not fit in swap stay as they were. */
+static struct frame* swap_batch(struct frame* const batch[], size_t cnt)
+{
+	void* kpages[SWAP_BATCH];
+	struct page* pages[SWAP_BATCH];
+	size_t slots[SWAP_BATCH];
+	size_t i, written;
+
+	written = swap_reserve(cnt, slots);
+
+	/* Unmap first, so that nobody writes a page while it is on
+		its way out.  A fault on one waits until it is out. */
+	for (i = 0; i < cnt; i++) {
+		pages[i] = sole_page(batch[i]);
+		pagedir_clear_page(pages[i]->pd, pages[i]->upage);
+		kpages[i] = batch[i]->kpage;
+		pin(batch[i]);
+	}
+
+	page_drop_lock();
+	swap_write(kpages, written, slots);
+	page_take_lock();
+
+	for (i = 0; i < cnt; i++) {
+		struct frame* f = batch[i];
+		struct page* p = pages[i];
+
+		unpin(f, p);
+		if (i < written) {
+			p->swap_slot = slots[i];
+			detach_all(f);
+			if (i > 0)
+				discard(f);
+		} else {
+			/* The page table exists, so this cannot fail. */
+			if (!pagedir_set_page(p->pd, p->upage, f->kpage, p->writable))
+				PANIC("frame: remapping user page failed");
+			pagedir_set_dirty(p->pd, p->upage, true);
+		}
+	}
+	return written > 0 ? batch[0] : NULL;
+}
+
+/* Returns true if any of F's pages was accessed since the last
+	call, clearing their accessed bits.  Counts pages brought in by
+	fault-around as used. */
+static bool test_and_clear_accessed(struct frame* f)
+{
+	struct list_elem* e;
+	bool accessed = false;
+
+	for (e = list_begin(&f->pages); e != list_end(&f->pages); e = list_next(e)) {
+		struct page* p = list_entry(e, struct page, frame_elem);
+		if (pagedir_is_accessed(p->pd, p->upage)) {
+			pagedir_set_accessed(p->pd, p->upage, false);
+			accessed = true;
+			if (p->around) {
+				p->around = false;
+				p->pt->around_hits++;
+			}
+		}
+	}
+	return accessed;
+}
+
+/* Unmaps F's pages and returns true if all of them are clean;
+	leaves them mapped and returns false if any is dirty.
+	Interrupts are off in between, so that no process can dirty a
+	page after we look. */
+static bool unmap_if_clean(struct frame* f)
+{
+	enum intr_level old_level = intr_disable();
+	struct list_elem* e;
+	bool clean = true;
+
+	for (e = list_begin(&f->pages); e != list_end(&f->pages); e = list_next(e)) {
+		struct page* p = list_entry(e, struct page, frame_elem);
+		if (pagedir_is_dirty(p->pd, p->upage))
+			clean = false;
+	}
+	if (clean)
+		for (e = list_begin(&f->pages); e != list_end(&f->pages); e = list_next(e)) {
+			struct page* p = list_entry(e, struct page, frame_elem);
+			pagedir_clear_page(p->pd, p->upage);
+		}
+	intr_set_level(old_level);
+	return clean;
+}
+
+/* Finds a frame whose pages can be pushed out, unmaps it, and
+	returns it with no pages attached.  Returns a null pointer if
+	every page is dirty and swap is full or absent. */
+static struct frame* evict(void)
+{
+	struct frame* batch[SWAP_BATCH];
+	size_t batch_cnt = 0;
+	bool swappable = swap_available();
+	size_t i, n = list_size(&frames);
+
+	/* Two turns: the first may only clear accessed bits. */
+	for (i = 0; i < 2 * n && batch_cnt < SWAP_BATCH; i++) {
+		struct frame* f = advance_hand();
+
+		if (f->pinned || test_and_clear_accessed(f))
+			continue;
+		if (unmap_if_clean(f)) {
+			detach_all(f);
+			return f;
+		}
+
+		/* Only private pages can be dirty. */
+		if (sole_page(f)->write_back) {
+			struct page* p = sole_page(f);
+			pagedir_clear_page(p->pd, p->upage);
+			pin(f);
+			page_drop_lock();
+			page_write_back(p, f->kpage);
+			page_take_lock();
+			unpin(f, p);
+			detach_all(f);
+			return f;
+		} else if (swappable && !in_batch(batch, batch_cnt, f))
+			batch[batch_cnt++] = f;
+	}
+	return batch_cnt > 0 ? swap_batch(batch, batch_cnt) : NULL;
+}
+
+/* Returns a frame holding page P of page directory PD, and sets
+	P's frame.  If the user pool is empty, evicts another page if
+	MAY_EVICT is true, and fails otherwise.  Eviction may drop the
+	VM lock for a while, so P must be busy.  The frame's contents
+	are garbage, and it is not yet mapped.  Returns a null pointer
+	if no frame can be had. */
+struct frame* frame_alloc(struct page* p, uint32_t* pd, bool may_evict)
+{
+	uint8_t* kpage;
+	struct frame* f = NULL;
+
+	ASSERT(p->busy || !may_evict);
+
+	while ((kpage = palloc_get_page(PAL_USER)) == NULL && may_evict) {
+		f = evict();
+		if (f != NULL || pinned_cnt == 0)
+			break;
+
+		/* Every candidate is on its way out for someone else. */
+		page_wait_io();
+	}
+
+	if (kpage == NULL) {
+		if (f == NULL)
+			return NULL;
+	} else {
+		f = malloc(sizeof *f);
+		if (f == NULL) {
+			palloc_free_page(kpage);
+			return NULL;
+		}
+		f->kpage = kpage;
+		f->shared = false;
+		f->pinned = false;
+		list_init(&f->pages);
+		list_push_back(&frames, &f->elem);
+	}
+	frame_attach(f, p, pd);
+	return f;
+}
+
+/* Adds page P of page directory PD to the pages that hold F, and
+	sets P's frame.  The caller maps it. */
+void frame_attach(struct frame* f, struct page* p, uint32_t* pd)
+{
+	p->frame = f;
+	p->pd = pd;
+	p->around = false;
+	list_push_back(&f->pages, &p->frame_elem);
+}
+
+/* Unmaps P, which must be resident, and detaches it from its
+	frame.  Frees the frame if no other page holds it, unless it is
+	the zero frame. */
+void frame_release(struct page* p)
+{
+	struct frame* f = p->frame;
+
+	pagedir_clear_page(p->pd, p->upage);
+	list_remove(&p->frame_elem);
+	p->frame = NULL;
+	if (list_empty(&f->pages) && f != &zero_frame) {
+		detach_all(f);
+		discard(f);
+	}
+}
+
+/* Maps KPAGE, a user pool page, in place of F's frame and frees
+	the old frame.  The page's contents are now KPAGE's, which
+	nothing else can recreate, so it is marked dirty.  F must not
+	be shared. */
+void frame_exchange(struct frame* f, void* kpage)
+{
+	struct page* p = sole_page(f);
+
+	ASSERT(!f->shared);
+
+	pagedir_clear_page(p->pd, p->upage);
+	if (!pagedir_set_page(p->pd, p->upage, kpage, p->writable))
+		PANIC("frame: remapping user page failed");
+	pagedir_set_dirty(p->pd, p->upage, true);
+	palloc_free_page(f->kpage);
+	f->kpage = kpage;
+}
+
+/* Returns the shared text frame holding READ_BYTES bytes from
+	offset OFS of the executable whose inode is INODE, followed by
+	zeroes, or a null pointer if no process has it resident. */
+struct frame* frame_lookup_shared(struct inode* inode, off_t ofs, uint32_t read_bytes)
+{
+	struct frame key;
+	struct hash_elem* e;
+
+	key.inode = inode;
+	key.ofs = ofs;
+	key.read_bytes = read_bytes;
+	e = hash_find(&text_cache, &key.cache_elem);
+	return e != NULL ? hash_entry(e, struct frame, cache_elem) : NULL;
+}
+
+/* Enters F, freshly filled with READ_BYTES bytes from offset OFS
+	of the executable whose inode is INODE, into the text cache, so
+	that other processes can share it. */
+void frame_share(struct frame* f, struct inode* inode, off_t ofs, uint32_t read_bytes)
+{
+	ASSERT(!f->shared);
+
+	f->inode = inode;
+	f->ofs = ofs;
+	f->read_bytes = read_bytes;
+	if (hash_insert(&text_cache, &f->cache_elem) == NULL)
+		f->shared = true;
+}
+
+/* Returns a hash value for the text frame that E refers to. */
+static unsigned cache_hash(const struct hash_elem* e, void* aux UNUSED)
+{
+	const struct frame* f = hash_entry(e, struct frame, cache_elem);
+	return hash_bytes(&f->inode, sizeof f->inode) ^ hash_int(f->ofs);
+}
+
+/* Returns true if text frame A precedes text frame B. */
+static bool cache_less(const struct hash_elem* a_, const struct hash_elem* b_, void* aux UNUSED)
+{
+	const struct frame* a = hash_entry(a_, struct frame, cache_elem);
+	const struct frame* b = hash_entry(b_, struct frame, cache_elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
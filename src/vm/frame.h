@@ -0,0 +1,46 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include "filesys/off_t.h"
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct inode;
+struct page;
+
+/* A frame from the user pool holding a user page.
+
+	Usually one page of one process maps the frame.  A frame
+	holding read-only text is shared instead by every process
+	running that executable; it is found through the text cache
+	by INODE, OFS and READ_BYTES, and is freed when the last of
+	its pages goes. */
+struct frame {
+	struct list_elem elem;			/* Element in the frame table. */
+	uint8_t* kpage;					/* Kernel virtual address of the frame. */
+	struct list pages;				/* struct page's mapping it. */
+	bool pinned;						/* Being written out; not evictable. */
+
+	/* Shared text only. */
+	bool shared;						/* In the text cache? */
+	struct hash_elem cache_elem;	/* Element in the text cache. */
+	struct inode* inode;				/* Executable's inode. */
+	off_t ofs;							/* Offset in the executable. */
+	uint32_t read_bytes;				/* Bytes read from there; the rest are zero. */
+};
+
+void frame_init(void);
+struct frame* frame_alloc(struct page*, uint32_t* pd, bool may_evict);
+void frame_release(struct page*);
+void frame_exchange(struct frame*, void* kpage);
+struct frame* frame_lookup_shared(struct inode*, off_t ofs, uint32_t read_bytes);
+void frame_share(struct frame*, struct inode*, off_t ofs, uint32_t read_bytes);
+void frame_attach(struct frame*, struct page*, uint32_t* pd);
+struct frame* frame_zero(void);
+void frame_pin(struct frame*);
+void frame_unpin(struct frame*);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,136 @@
+#include "vm/mmap.h"
+
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/ioring.h"
+#include "userprog/process.h"
+#include "vm/page.h"
+
+#include <list.h>
+#include <round.h>
+
+/* Memory-mapped files.
+
+	A mapping is a run of pages in the supplemental page table
+	that are backed by a file and marked to be written back to it.
+	They fault in from the file like executable pages do.  When a
+	page is evicted, or the mapping is removed, a page whose dirty
+	bit is set is written back; a clean page costs no I/O.
+
+	Each mapping has its own handle on the file, so closing the
+	descriptor that it was made from does not affect it.  Only the
+	process itself changes its list of mappings, so the list needs
+	no lock. */
+struct mapping {
+	struct list_elem elem; /* Element in struct page_table's list. */
+	int id;						/* Mapping id. */
+	struct file* file;		/* File mapped. */
+	uint8_t* base;				/* First page mapped. */
+	size_t page_cnt;			/* Number of pages mapped. */
+};
+
+/* Removes PAGE_CNT pages starting at BASE from PT. */
+static void remove_pages(struct page_table* pt, uint8_t* base, size_t page_cnt)
+{
+	size_t i;
+
+	for (i = 0; i < page_cnt; i++)
+		page_remove(pt, base + i * PGSIZE);
+}
+
+/* Maps all of FILE into the current process's address space,
+	starting at ADDR.  Fails if FILE is empty, if ADDR is null or
+	not page-aligned, or if any page of the range is already in
+	use or lies in the area reserved for the stack.  Returns the
+	new mapping's id, or -1 on failure. */
+int mmap_map(struct file* file, void* addr_)
+{
+	struct thread* t = thread_current();
+	struct page_table* pt = t->pages;
+	uint8_t* addr = addr_;
+	struct mapping* m;
+	off_t length;
+	size_t page_cnt, i;
+
+	if (pt == NULL || addr == NULL || pg_ofs(addr) != 0)
+		return -1;
+	length = file_length(file);
+	if (length == 0)
+		return -1;
+	page_cnt = DIV_ROUND_UP(length, PGSIZE);
+	if (addr >= USER_STACK_BOTTOM || page_cnt > (size_t) (USER_STACK_BOTTOM - addr) / PGSIZE)
+		return -1;
+
+	/* Pages in the page table are checked as they are added, but
+		the I/O ring's pages are not in it. */
+	if (ioring_overlaps(t, addr, page_cnt * PGSIZE))
+		return -1;
+
+	m = malloc(sizeof *m);
+	if (m == NULL)
+		return -1;
+	m->file = file_reopen(file);
+	if (m->file == NULL) {
+		free(m);
+		return -1;
+	}
+	m->base = addr;
+	m->page_cnt = page_cnt;
+
+	for (i = 0; i < page_cnt; i++) {
+		off_t ofs = i * PGSIZE;
+		uint32_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+		if (!page_add_mmap(pt, addr + ofs, m->file, ofs, read_bytes)) {
+			remove_pages(pt, addr, i);
+			file_close(m->file);
+			free(m);
+			return -1;
+		}
+	}
+
+	m->id = pt->next_mapid++;
+	list_push_back(&pt->mappings, &m->elem);
+	return m->id;
+}
+
+/* Writes back and removes mapping M of the current process. */
+static void unmap(struct mapping* m)
+{
+	remove_pages(thread_current()->pages, m->base, m->page_cnt);
+	file_close(m->file);
+	list_remove(&m->elem);
+	free(m);
+}
+
+/* Removes the current process's mapping MAPID, writing changed
+	pages back to the file.  Does nothing if there is no such
+	mapping. */
+void mmap_unmap(int mapid)
+{
+	struct page_table* pt = thread_current()->pages;
+	struct list_elem* e;
+
+	if (pt == NULL)
+		return;
+	for (e = list_begin(&pt->mappings); e != list_end(&pt->mappings); e = list_next(e)) {
+		struct mapping* m = list_entry(e, struct mapping, elem);
+		if (m->id == mapid) {
+			unmap(m);
+			return;
+		}
+	}
+}
+
+/* Removes all of the current process's mappings, as it exits. */
+void mmap_unmap_all(void)
+{
+	struct page_table* pt = thread_current()->pages;
+
+	if (pt == NULL)
+		return;
+	while (!list_empty(&pt->mappings))
+		unmap(list_entry(list_front(&pt->mappings), struct mapping, elem));
+}
@@ -0,0 +1,600 @@
+#include "vm/page.h"
+
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Demand paging.
+
+	load() no longer reads the executable into memory.  Instead it
+	records, for each page of each segment, where the page's
+	contents come from, in the process's supplemental page table.
+	The first access to a page faults, and page_fault_in() fills a
+	frame and maps it.  Pages that are never touched mostly never
+	cost a frame or a disk read.  A fault on a file-backed page also
+	reads in the pages after it that continue the same file data,
+	up to FAULT_AROUND_PAGES in all, with a single request, since
+	sequential access is the common case.  A page that starts out
+	zeroed and is only read maps the shared zero frame, read-only;
+	its first write faults again and copies it into a frame of its
+	own, so large, sparsely used BSS and heap areas cost little.
+
+	Frames come from the frame table (see vm/frame.c), which
+	evicts a page when the user pool runs out: a clean page is
+	simply dropped, a dirty one is written to swap (see
+	vm/swap.c) and read back on its next fault.  Read-only text is
+	shared: a process faulting on a text page that another process
+	running the same executable has resident just maps that frame.
+
+	Page faults may be taken by the process itself, by the kernel
+	while it copies to or from user memory, or by an I/O ring
+	worker acting for the process, so the tables are shared state.
+	VM_LOCK protects every page table.  Nothing holding it touches
+	user memory, so it never faults.
+
+	No disk I/O happens under VM_LOCK either, so that other faults
+	need not wait for the disk: eviction drops it while it writes
+	pages to swap or back to their files, and page_fault_in() while
+	it reads a page in.  Pages on their way out or in are marked
+	busy first, and their frames pinned.  Whoever finds a busy page
+	waits on IO_DONE until it is no longer busy. */
+static struct lock vm_lock;
+static struct condition io_done;
+
+/* Most pages one fault brings in, counting the faulting page. */
+#define FAULT_AROUND_PAGES 8
+
+/* Statistics, summed over processes that have exited. */
+static long long fault_cnt;		/* Faults that loaded a page. */
+static long long around_cnt;		/* Pages loaded by fault-around. */
+static long long around_hit_cnt; /* Of those, pages later used. */
+static long long zero_map_cnt;	/* Zero-fill pages mapped to the zero frame. */
+static long long zero_copy_cnt;	/* Of those, pages later written. */
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+
+/* Initializes the virtual memory system. */
+void page_init(void)
+{
+	lock_init_named(&vm_lock, "vm");
+	cond_init(&io_done);
+	frame_init();
+	swap_init();
+}
+
+/* Creates an empty page table.  Returns a null pointer if memory
+	is exhausted. */
+struct page_table* page_table_create(void)
+{
+	struct page_table* pt = malloc(sizeof *pt);
+
+	if (pt == NULL)
+		return NULL;
+	if (!hash_init(&pt->pages, page_hash, page_less, NULL)) {
+		free(pt);
+		return NULL;
+	}
+	list_init(&pt->mappings);
+	pt->next_mapid = 0;
+	pt->faults = pt->around = pt->around_hits = 0;
+	pt->zero_maps = pt->zero_copies = 0;
+	return pt;
+}
+
+/* Frees a struct page and its frame or swap slot, if any, once
+	it is not busy.  A memory-mapped page that was changed is first
+	written back. */
+static void page_destroy(struct hash_elem* e, void* aux UNUSED)
+{
+	struct page* p = hash_entry(e, struct page, elem);
+
+	while (p->busy)
+		cond_wait(&io_done, &vm_lock);
+	if (p->frame != NULL) {
+		if (p->around && pagedir_is_accessed(p->pd, p->upage))
+			p->pt->around_hits++;
+
+		/* Unmap first, so that the dirty bit is final. */
+		pagedir_clear_page(p->pd, p->upage);
+		if (p->write_back && pagedir_is_dirty(p->pd, p->upage))
+			page_write_back(p, p->frame->kpage);
+		frame_release(p);
+	}
+	if (p->swap_slot != SWAP_NONE)
+		swap_free(p->swap_slot);
+	free(p);
+}
+
+/* Destroys PT, unmapping and freeing its resident pages.  This
+	must happen before the page directory that maps them is
+	destroyed. */
+void page_table_destroy(struct page_table* pt)
+{
+	if (pt == NULL)
+		return;
+	lock_acquire(&vm_lock);
+	hash_destroy(&pt->pages, page_destroy);
+	fault_cnt += pt->faults;
+	around_cnt += pt->around;
+	around_hit_cnt += pt->around_hits;
+	zero_map_cnt += pt->zero_maps;
+	zero_copy_cnt += pt->zero_copies;
+	lock_release(&vm_lock);
+	free(pt);
+}
+
+/* Returns the page at UPAGE in PT, or a null pointer if there is
+	none.  VM_LOCK must be held. */
+static struct page* lookup(struct page_table* pt, const void* upage)
+{
+	struct page p;
+	struct hash_elem* e;
+
+	ASSERT(lock_held_by_current_thread(&vm_lock));
+
+	p.upage = (uint8_t*) upage;
+	e = hash_find(&pt->pages, &p.elem);
+	return e != NULL ? hash_entry(e, struct page, elem) : NULL;
+}
+
+/* Returns a new page of PT at UPAGE holding READ_BYTES bytes from
+	FILE at offset OFS followed by zeroes, or a null pointer if
+	memory is exhausted.  The page is not yet in PT. */
+static struct page* new_page(struct page_table* pt, void* upage, struct file* file, off_t ofs,
+									  uint32_t read_bytes, bool writable)
+{
+	struct page* p;
+
+	ASSERT(pg_ofs(upage) == 0);
+	ASSERT(read_bytes <= PGSIZE);
+	ASSERT(file != NULL || read_bytes == 0);
+
+	p = malloc(sizeof *p);
+	if (p == NULL)
+		return NULL;
+	p->upage = upage;
+	p->writable = writable;
+	p->file = read_bytes > 0 ? file : NULL;
+	p->ofs = ofs;
+	p->read_bytes = read_bytes;
+	p->write_back = false;
+	p->frame = NULL;
+	p->swap_slot = SWAP_NONE;
+	p->pt = pt;
+	p->around = false;
+	p->busy = false;
+	return p;
+}
+
+/* Adds P, which may be null, to PT.  Returns false, freeing P,
+	if P is null or its address is already in PT. */
+static bool insert(struct page_table* pt, struct page* p)
+{
+	bool success;
+
+	if (p == NULL)
+		return false;
+
+	lock_acquire(&vm_lock);
+	success = hash_insert(&pt->pages, &p->elem) == NULL;
+	lock_release(&vm_lock);
+
+	if (!success)
+		free(p);
+	return success;
+}
+
+/* Records that user page UPAGE holds READ_BYTES bytes from FILE
+	at offset OFS followed by zeroes, and is writable if WRITABLE.
+	FILE may be null if READ_BYTES is 0.  Returns false if UPAGE is
+	already in PT or memory is exhausted. */
+bool page_add_file(struct page_table* pt, void* upage, struct file* file, off_t ofs,
+						 uint32_t read_bytes, bool writable)
+{
+	return insert(pt, new_page(pt, upage, file, ofs, read_bytes, writable));
+}
+
+/* Records that user page UPAGE starts out zeroed. */
+bool page_add_zero(struct page_table* pt, void* upage, bool writable)
+{
+	return page_add_file(pt, upage, NULL, 0, 0, writable);
+}
+
+/* Records that user page UPAGE maps READ_BYTES bytes of FILE at
+	offset OFS, followed by zeroes.  Unlike page_add_file(), writes
+	to the page go back to FILE when it is evicted or removed. */
+bool page_add_mmap(struct page_table* pt, void* upage, struct file* file, off_t ofs,
+						 uint32_t read_bytes)
+{
+	struct page* p = new_page(pt, upage, file, ofs, read_bytes, true);
+
+	if (p != NULL)
+		p->write_back = true;
+	return insert(pt, p);
+}
+
+/* Removes UPAGE from PT, unmapping and freeing it if it is
+	resident, after writing it back if it is a changed page of a
+	memory-mapped file.  Does nothing if UPAGE is not in PT. */
+void page_remove(struct page_table* pt, void* upage)
+{
+	struct page* p;
+
+	lock_acquire(&vm_lock);
+	while ((p = lookup(pt, upage)) != NULL && p->busy)
+		cond_wait(&io_done, &vm_lock);
+	if (p != NULL) {
+		hash_delete(&pt->pages, &p->elem);
+		page_destroy(&p->elem, NULL);
+	}
+	lock_release(&vm_lock);
+}
+
+/* Returns true if any of the PAGE_CNT pages starting at UPAGE is
+	in PT. */
+bool page_range_used(struct page_table* pt, const void* upage, size_t page_cnt)
+{
+	const uint8_t* start = upage;
+	bool used = false;
+	size_t i;
+
+	lock_acquire(&vm_lock);
+	for (i = 0; i < page_cnt && !used; i++)
+		used = lookup(pt, start + i * PGSIZE) != NULL;
+	lock_release(&vm_lock);
+	return used;
+}
+
+/* Returns true if P is read-only text that processes running the
+	same executable can share. */
+static bool is_shared_text(const struct page* p)
+{
+	return p->file != NULL && !p->writable && !p->write_back;
+}
+
+/* Returns true if P is nothing but zeroes, and would be recreated
+	as such if it were dropped. */
+static bool is_zero_fill(const struct page* p)
+{
+	return p->file == NULL && p->swap_slot == SWAP_NONE && !p->write_back;
+}
+
+/* Releases VM_LOCK while the caller reads into F, the frame of a
+	busy page, pinning F so that no eviction takes it meanwhile. */
+static void drop_lock_for_read(struct frame* f)
+{
+	frame_pin(f);
+	lock_release(&vm_lock);
+}
+
+/* Undoes drop_lock_for_read(). */
+static void retake_lock_after_read(struct frame* f)
+{
+	lock_acquire(&vm_lock);
+	frame_unpin(f);
+}
+
+/* Fills a frame with P's contents and maps it in PD.  Text that
+	another process already has resident is mapped from its frame
+	instead, and so is the zero frame for a zero-fill page, unless
+	the access is a WRITE.  VM_LOCK is released while the frame is
+	read from disk, so P must be busy.  Returns false if no frame
+	can be had or the file is short. */
+static bool load_page(uint32_t* pd, struct page* p, bool write)
+{
+	bool swapped = p->swap_slot != SWAP_NONE;
+	bool shared = is_shared_text(p);
+	struct inode* inode = shared ? file_get_inode(p->file) : NULL;
+	struct frame* f;
+
+	if (!write && is_zero_fill(p)) {
+		f = frame_zero();
+		if (!pagedir_set_page(pd, p->upage, f->kpage, false))
+			return false;
+		frame_attach(f, p, pd);
+		p->pt->zero_maps++;
+		return true;
+	}
+	if (shared) {
+		f = frame_lookup_shared(inode, p->ofs, p->read_bytes);
+		if (f != NULL) {
+			if (!pagedir_set_page(pd, p->upage, f->kpage, false))
+				return false;
+			frame_attach(f, p, pd);
+			return true;
+		}
+	}
+
+	f = frame_alloc(p, pd, true);
+	if (f == NULL)
+		return false;
+	if (swapped) {
+		drop_lock_for_read(f);
+		swap_read(p->swap_slot, f->kpage);
+		retake_lock_after_read(f);
+		swap_free(p->swap_slot);
+		p->swap_slot = SWAP_NONE;
+	} else {
+		if (p->read_bytes > 0) {
+			off_t read;
+
+			drop_lock_for_read(f);
+			read = file_read_at(p->file, f->kpage, p->read_bytes, p->ofs);
+			retake_lock_after_read(f);
+			if (read != (off_t) p->read_bytes) {
+				frame_release(p);
+				return false;
+			}
+		}
+		memset(f->kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+	}
+
+	if (!pagedir_set_page(pd, p->upage, f->kpage, p->writable)) {
+		frame_release(p);
+		return false;
+	}
+
+	if (shared)
+		frame_share(f, inode, p->ofs, p->read_bytes);
+
+	/* The swap slot is gone, so only this frame has the data. */
+	if (swapped)
+		pagedir_set_dirty(pd, p->upage, true);
+	return true;
+}
+
+/* Returns true if Q holds the file data that follows P's, K pages
+	further on, so that both can be read together. */
+static bool continues(const struct page* p, const struct page* q, size_t k)
+{
+	return q->frame == NULL && !q->busy && q->swap_slot == SWAP_NONE && q->file == p->file
+			 && q->ofs == p->ofs + (off_t) (k * PGSIZE) && q->read_bytes > 0
+			 && q->writable == p->writable && q->write_back == p->write_back;
+}
+
+/* Returns true if P is shared text that some process already has
+	resident. */
+static bool text_resident(const struct page* p)
+{
+	return is_shared_text(p)
+			 && frame_lookup_shared(file_get_inode(p->file), p->ofs, p->read_bytes) != NULL;
+}
+
+/* Loads P, which is backed by a file, together with up to
+	FAULT_AROUND_PAGES - 1 of the pages after it that are backed by
+	the following file data and are not resident, reading them all
+	with one request.  Neighbours get frames only if the user pool
+	has them free; they are never worth an eviction.  Returns false
+	if P could not be loaded. */
+static bool load_around(struct page_table* pt, uint32_t* pd, struct page* p)
+{
+	struct page* window[FAULT_AROUND_PAGES];
+	size_t cnt, i, j;
+	off_t size, read;
+	uint8_t* buf;
+
+	/* Gather the window.  Text some process has resident is
+		shared, not read. */
+	if (text_resident(p))
+		return load_page(pd, p, false);
+	window[0] = p;
+	for (cnt = 1; cnt < FAULT_AROUND_PAGES && window[cnt - 1]->read_bytes == PGSIZE; cnt++) {
+		struct page* q = lookup(pt, p->upage + cnt * PGSIZE);
+		if (q == NULL || !continues(p, q, cnt) || text_resident(q))
+			break;
+		window[cnt] = q;
+	}
+	if (cnt == 1)
+		return load_page(pd, p, false);
+
+	size = (cnt - 1) * PGSIZE + window[cnt - 1]->read_bytes;
+	buf = palloc_get_multiple(0, cnt);
+	if (buf == NULL)
+		return load_page(pd, p, false);
+
+	/* Other faults run while we read, and while P's frame comes
+		from an eviction.  Keep them off the neighbours. */
+	for (j = 1; j < cnt; j++)
+		window[j]->busy = true;
+	lock_release(&vm_lock);
+	read = file_read_at(p->file, buf, size, p->ofs);
+	lock_acquire(&vm_lock);
+	if (read != size) {
+		for (j = 1; j < cnt; j++)
+			page_unbusy(window[j]);
+		palloc_free_multiple(buf, cnt);
+		return load_page(pd, p, false);
+	}
+
+	for (i = 0; i < cnt; i++) {
+		struct page* q = window[i];
+		struct frame* f = frame_alloc(q, pd, i == 0);
+
+		if (f == NULL)
+			break;
+		memcpy(f->kpage, buf + i * PGSIZE, q->read_bytes);
+		memset(f->kpage + q->read_bytes, 0, PGSIZE - q->read_bytes);
+		if (!pagedir_set_page(pd, q->upage, f->kpage, q->writable)) {
+			frame_release(q);
+			break;
+		}
+		if (is_shared_text(q))
+			frame_share(f, file_get_inode(q->file), q->ofs, q->read_bytes);
+		if (i > 0) {
+			q->around = true;
+			pt->around++;
+		}
+	}
+	for (j = 1; j < cnt; j++)
+		page_unbusy(window[j]);
+	palloc_free_multiple(buf, cnt);
+	return i > 0;
+}
+
+/* Returns true if an access to FAULT_ADDR by a process whose
+	user stack pointer is ESP looks like a stack access: it lies
+	in the stack area and no more than 32 bytes below ESP, the
+	most that PUSHA pushes before it writes.  ESP is null if it is
+	not known, in which case the stack does not grow. */
+static bool is_stack_access(const void* fault_addr, const void* esp)
+{
+	return esp != NULL && (const uint8_t*) fault_addr >= USER_STACK_BOTTOM
+			 && (const uint8_t*) fault_addr + 32 >= (const uint8_t*) esp;
+}
+
+/* Brings in the page containing FAULT_ADDR for the current
+	thread's process, after a fault on a not-present page or, if
+	WRITE is true, a write to a read-only one.  If there is no such
+	page but the access looks like it is to the stack just below
+	user stack pointer ESP, adds a zero page there, growing the
+	stack.  A write to a page that maps the zero frame gives it a
+	frame of its own.  Returns true if the access can be retried,
+	false if the address is not part of the process's address
+	space, the access is a write to a read-only page, or the page
+	could not be loaded. */
+bool page_fault_in(const void* fault_addr, const void* esp, bool write)
+{
+	struct thread* t = thread_current();
+	void* upage = pg_round_down(fault_addr);
+	struct page* p;
+	bool success;
+
+	if (t->pages == NULL || t->pagedir == NULL)
+		return false;
+
+	lock_acquire(&vm_lock);
+	while ((p = lookup(t->pages, upage)) != NULL && p->busy)
+		cond_wait(&io_done, &vm_lock);
+	if (p == NULL && is_stack_access(fault_addr, esp)) {
+		p = new_page(t->pages, upage, NULL, 0, 0, true);
+		if (p != NULL)
+			hash_insert(&t->pages->pages, &p->elem);
+	}
+	if (p == NULL || (write && !p->writable))
+		success = false;
+	else if (write && p->frame == frame_zero()) {
+		frame_release(p);
+		p->busy = true;
+		success = load_page(t->pagedir, p, true);
+		page_unbusy(p);
+		t->pages->zero_copies++;
+	} else if (p->frame != NULL)
+		success = true; /* Someone else brought it in meanwhile. */
+	else {
+		p->busy = true;
+		if (p->file != NULL && p->swap_slot == SWAP_NONE)
+			success = load_around(t->pages, t->pagedir, p);
+		else
+			success = load_page(t->pagedir, p, write);
+		page_unbusy(p);
+		t->pages->faults++;
+	}
+	lock_release(&vm_lock);
+
+	return success;
+}
+
+/* Makes KPAGE, a user pool page that the caller gives up, the
+	frame of the current process's resident, writable page UPAGE,
+	freeing the frame it had.  Returns false, leaving KPAGE to the
+	caller, if UPAGE is not such a page or still maps the zero
+	frame. */
+bool page_donate(void* upage, void* kpage)
+{
+	struct thread* t = thread_current();
+	struct page* p;
+	bool success = false;
+
+	if (t->pages == NULL)
+		return false;
+
+	lock_acquire(&vm_lock);
+	p = lookup(t->pages, upage);
+	if (p != NULL && !p->busy && p->frame != NULL && p->frame != frame_zero() && p->writable) {
+		frame_exchange(p->frame, kpage);
+		success = true;
+	}
+	lock_release(&vm_lock);
+
+	return success;
+}
+
+/* Writes the part of KPAGE, the contents of memory-mapped page P,
+	that lies within P's file back to the file.  P must no longer
+	be mapped, so that nobody changes it meanwhile, and either
+	VM_LOCK must be held or P must be busy. */
+void page_write_back(struct page* p, const void* kpage)
+{
+	ASSERT(lock_held_by_current_thread(&vm_lock) || p->busy);
+	ASSERT(p->write_back);
+
+	file_write_at(p->file, kpage, p->read_bytes, p->ofs);
+}
+
+/* Releases VM_LOCK so that the caller can do I/O on pages it has
+	marked busy without holding up other faults. */
+void page_drop_lock(void)
+{
+	lock_release(&vm_lock);
+}
+
+/* Reacquires VM_LOCK after page_drop_lock(). */
+void page_take_lock(void)
+{
+	lock_acquire(&vm_lock);
+}
+
+/* Waits, with VM_LOCK held, until some busy page is no longer
+	busy. */
+void page_wait_io(void)
+{
+	ASSERT(lock_held_by_current_thread(&vm_lock));
+	cond_wait(&io_done, &vm_lock);
+}
+
+/* Marks busy page P as no longer busy and wakes those waiting for
+	it.  VM_LOCK must be held. */
+void page_unbusy(struct page* p)
+{
+	ASSERT(lock_held_by_current_thread(&vm_lock));
+	ASSERT(p->busy);
+
+	p->busy = false;
+	cond_broadcast(&io_done, &vm_lock);
+}
+
+/* Prints paging statistics. */
+void page_print_stats(void)
+{
+	printf("Paging: %lld faults, %lld pages faulted around, %lld of them used\n",
+			 fault_cnt, around_cnt, around_hit_cnt);
+	printf("Paging: %lld pages mapped to the zero frame, %lld of them copied on write\n",
+			 zero_map_cnt, zero_copy_cnt);
+}
+
+/* Returns a hash value for the page that E refers to. */
+static unsigned page_hash(const struct hash_elem* e, void* aux UNUSED)
+{
+	const struct page* p = hash_entry(e, struct page, elem);
+	return hash_bytes(&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool page_less(const struct hash_elem* a_, const struct hash_elem* b_, void* aux UNUSED)
+{
+	const struct page* a = hash_entry(a_, struct page, elem);
+	const struct page* b = hash_entry(b_, struct page, elem);
+	return a->upage < b->upage;
+}
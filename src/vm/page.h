@@ -0,0 +1,77 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include "filesys/off_t.h"
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct file;
+struct frame;
+
+/* A user page that the process may touch, resident or not.
+
+	Until the page is first touched it has no frame; the page
+	fault handler then fills a frame with READ_BYTES bytes from
+	FILE at offset OFS, zeroes the rest, and maps it.  A zero page
+	that is only read maps the shared zero frame until it is first
+	written.  Once a page that was written has been evicted, its
+	contents live in swap slot SWAP_SLOT instead, unless it is part
+	of a memory-mapped file, in which case they are written back to
+	FILE. */
+struct page {
+	struct hash_elem elem;	/* Element in struct page_table's hash. */
+	uint8_t* upage;			/* User virtual address. */
+	bool writable;				/* May user code write to it? */
+	struct file* file;		/* Backing file, or null for a zero page. */
+	off_t ofs;					/* Offset in FILE. */
+	uint32_t read_bytes;		/* Bytes to read from FILE; the rest are zeroed. */
+	bool write_back;			/* Write changes back to FILE, not to swap? */
+	struct frame* frame;		/* Frame holding the page, or null. */
+	uint32_t* pd;				/* Page directory mapping it, while resident. */
+	struct list_elem frame_elem; /* Element in struct frame's list of pages. */
+	size_t swap_slot;			/* Swap slot holding the page, or SWAP_NONE. */
+	struct page_table* pt;	/* Page table it belongs to. */
+	bool around;				/* Brought in by fault-around, not yet used? */
+	bool busy;					/* Being loaded or pushed out? */
+};
+
+/* A process's supplemental page table: every user page that the
+	process may touch, keyed by user virtual address. */
+struct page_table {
+	struct hash pages;		/* Contains struct page. */
+	struct list mappings; /* Memory-mapped files; see vm/mmap.c. */
+	int next_mapid;			/* Id for the next mapping. */
+
+	/* Statistics. */
+	unsigned long faults;		 /* Faults that loaded a page. */
+	unsigned long around;		 /* Pages loaded by fault-around. */
+	unsigned long around_hits; /* Of those, pages later used. */
+	unsigned long zero_maps;	 /* Pages mapped to the zero frame. */
+	unsigned long zero_copies; /* Of those, pages later written. */
+};
+
+void page_init(void);
+struct page_table* page_table_create(void);
+void page_table_destroy(struct page_table*);
+bool page_add_file(struct page_table*, void* upage, struct file*, off_t ofs,
+						 uint32_t read_bytes, bool writable);
+bool page_add_zero(struct page_table*, void* upage, bool writable);
+bool page_add_mmap(struct page_table*, void* upage, struct file*, off_t ofs,
+						 uint32_t read_bytes);
+void page_remove(struct page_table*, void* upage);
+bool page_range_used(struct page_table*, const void* upage, size_t page_cnt);
+bool page_fault_in(const void* fault_addr, const void* esp, bool write);
+bool page_donate(void* upage, void* kpage);
+void page_write_back(struct page*, const void* kpage);
+void page_print_stats(void);
+
+void page_drop_lock(void);
+void page_take_lock(void);
+void page_wait_io(void);
+void page_unbusy(struct page*);
+
+#endif /* vm/page.h */
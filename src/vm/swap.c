@@ -0,0 +1,151 @@
+#include "vm/swap.h"
+
+#include "devices/block.h"
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+
+/* Swap space.
+
+	The swap device is divided into page-sized slots of
+	SECTORS_PER_SLOT sectors each, with a bitmap marking those in
+	use.  Eviction writes dirty pages out in batches; a batch goes
+	to consecutive slots when it can, so that the whole batch is
+	one multi-sector write.
+
+	Callers of everything but swap_write() and swap_read() hold the
+	VM lock, which also protects the bitmap.  Eviction gives up the
+	lock while it writes slots it has reserved with swap_reserve(),
+	and a fault while it reads a slot it frees only afterward. */
+
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block* swap_block; /* Swap device, or null. */
+static struct bitmap* used;		/* Slots in use. */
+
+/* Statistics. */
+static long long swap_in_cnt;	 /* Pages read back in. */
+static long long swap_out_cnt; /* Pages written out. */
+static long long write_cnt;	 /* Write commands issued. */
+
+/* Finds the swap device, if any, and sets up its slots. */
+void swap_init(void)
+{
+	swap_block = block_get_role(BLOCK_SWAP);
+	if (swap_block == NULL)
+		return;
+
+	used = bitmap_create(block_size(swap_block) / SECTORS_PER_SLOT);
+	if (used == NULL)
+		PANIC("swap: bitmap creation failed");
+}
+
+/* Returns true if there is a free swap slot. */
+bool swap_available(void)
+{
+	return used != NULL && !bitmap_all(used, 0, bitmap_size(used));
+}
+
+/* Writes the CNT slots starting at SLOT from KPAGES in a single
+	multi-sector write. */
+static void write_run(size_t slot, void* const kpages[], size_t cnt)
+{
+	const void* sectors[SWAP_BATCH * SECTORS_PER_SLOT];
+	size_t i;
+
+	ASSERT(cnt <= SWAP_BATCH);
+
+	for (i = 0; i < cnt * SECTORS_PER_SLOT; i++)
+		sectors[i] = (const uint8_t*) kpages[i / SECTORS_PER_SLOT]
+						 + i % SECTORS_PER_SLOT * BLOCK_SECTOR_SIZE;
+	block_write_multiple(swap_block, slot * SECTORS_PER_SLOT, cnt * SECTORS_PER_SLOT, sectors);
+}
+
+/* Returns the length of the run of consecutive slots that starts
+	at SLOTS[0], among the CNT in SLOTS. */
+static size_t run_length(const size_t slots[], size_t cnt)
+{
+	size_t run;
+
+	for (run = 1; run < cnt && slots[run] == slots[0] + run; run++)
+		continue;
+	return run;
+}
+
+/* Reserves slots for CNT pages, at most SWAP_BATCH, storing them
+	in SLOTS.  Uses consecutive slots if they are free, and
+	otherwise whatever slots are.  Returns the number of slots
+	reserved, which is less than CNT only if swap fills up. */
+size_t swap_reserve(size_t cnt, size_t slots[])
+{
+	size_t first, i;
+
+	ASSERT(cnt <= SWAP_BATCH);
+
+	if (used == NULL || cnt == 0)
+		return 0;
+
+	first = bitmap_scan_and_flip(used, 0, cnt, false);
+	if (first != BITMAP_ERROR) {
+		for (i = 0; i < cnt; i++)
+			slots[i] = first + i;
+	} else {
+		for (i = 0; i < cnt; i++) {
+			slots[i] = bitmap_scan_and_flip(used, 0, 1, false);
+			if (slots[i] == BITMAP_ERROR)
+				break;
+		}
+		cnt = i;
+	}
+
+	swap_out_cnt += cnt;
+	for (i = 0; i < cnt; i += run_length(slots + i, cnt - i))
+		write_cnt++;
+	return cnt;
+}
+
+/* Writes the CNT pages at KPAGES to the slots in SLOTS, reserved
+	by swap_reserve(), with one write per run of consecutive slots.
+	Needs no lock. */
+void swap_write(void* kpages[], size_t cnt, const size_t slots[])
+{
+	size_t i, run;
+
+	for (i = 0; i < cnt; i += run) {
+		run = run_length(slots + i, cnt - i);
+		write_run(slots[i], kpages + i, run);
+	}
+}
+
+/* Reads the page in SLOT into KPAGE.  Needs no lock; the caller
+	frees SLOT with swap_free() afterward. */
+void swap_read(size_t slot, void* kpage)
+{
+	enum intr_level old_level;
+	size_t i;
+
+	for (i = 0; i < SECTORS_PER_SLOT; i++)
+		block_read(
+			 swap_block, slot * SECTORS_PER_SLOT + i, (uint8_t*) kpage + i * BLOCK_SECTOR_SIZE);
+
+	old_level = intr_disable();
+	swap_in_cnt++;
+	intr_set_level(old_level);
+}
+
+/* Frees SLOT without reading it. */
+void swap_free(size_t slot)
+{
+	ASSERT(used != NULL && bitmap_test(used, slot));
+	bitmap_reset(used, slot);
+}
+
+/* Prints swap statistics. */
+void swap_print_stats(void)
+{
+	printf("Swap: %lld pages in, %lld pages out in %lld writes\n",
+			 swap_in_cnt, swap_out_cnt, write_cnt);
+}
@@ -0,0 +1,22 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A swap slot that holds nothing. */
+#define SWAP_NONE SIZE_MAX
+
+/* Most pages swap_reserve() and swap_write() handle at once. */
+#define SWAP_BATCH 8
+
+void swap_init(void);
+bool swap_available(void);
+size_t swap_reserve(size_t cnt, size_t slots[]);
+void swap_write(void* kpages[], size_t cnt, const size_t slots[]);
+void swap_read(size_t slot, void* kpage);
+void swap_free(size_t slot);
+void swap_print_stats(void);
+
+#endif /* vm/swap.h */